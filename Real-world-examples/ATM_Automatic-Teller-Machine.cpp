@@ -24,6 +24,13 @@ The ATM supports the following operations:
 - Cash withdrawal
 - Balance inquiry
 - Card ejection and session cleanup
+- Per-account statement (columnar, append-only) and a
+  daily withdrawal limit
+- Cassette run-out forecasts from hourly dispense
+  telemetry, for planning refills
+- Headless fleet simulation (generated session mixes,
+  JSON report of throughput, latency, failures and cash
+  depletion)
 
 -----------------------------------------------------------
 USER FLOW (HIGH LEVEL):
@@ -49,21 +56,37 @@ system easy to extend with new states or operations.
 
 -----------------------------------------------------------
 KEY DESIGN DECISIONS:
-- ATMMachine owns all Account objects (simplified model)
+- Accounts live in an AccountLedger that many ATMMachines
+  can share; balances are integer paise updated with CAS
+  so concurrent debits never overdraw an account
 - ATMInventory is composed within ATMMachine
-- ATMState objects are shared and stateless
+- States are rows of a compile-time fsm::StateMachine
+  (StateMachine.h, shared with the vending machines) with
+  static_assert'ed invariants, dispatched through a flat
+  (state x event) table of actions
+- States never read std::cin themselves: customer actions
+  arrive as ATMEvents on a per-session queue, so one
+  ATMEventLoop can drive thousands of ATMs on a thread
 - Account balance updates and cash dispensing are handled
   atomically with rollback on failure
+- All amounts are Money (Money.h): integer paise with
+  overflow-checked arithmetic, so debits are exact
 - User session data (card, account, operation) is cleared
   after each transaction
 
 -----------------------------------------------------------
 FAILURE SCENARIOS HANDLED:
 - Invalid PIN entry
+- Repeated wrong PINs (card blocked by the CardDirectory)
+- Daily withdrawal limit reached
 - Insufficient account balance
 - Insufficient ATM cash
-- Inability to dispense exact cash amount
+- Inability to dispense exact cash amount (only when no
+  note mix from the current cassettes adds up to it)
 - User cancellation during transaction
+- Crash between debit and dispense (reconciled on restart
+  from the transaction journal; retried requests with a
+  known idempotency key are ignored)
 
 -----------------------------------------------------------
 DESIGN GOALS:
@@ -79,54 +102,483 @@ DESIGN GOALS:
 #include<iostream>
 #include<unordered_map>
 #include<vector>
+#include<deque>
+#include<atomic>
+#include<mutex>
+#include<thread>
+#include<chrono>
+#include<random>
+#include<cmath>
+#include<cstdio>
+#include<cstring>
+#include<cstdint>
+#include<unordered_set>
+#include<algorithm>
+#include<sstream>
+#include<ctime>
+#include<cstdlib>
+
+#include "Money.h"
+#include "StateMachine.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
 
 using namespace std;
 
+// The PIN is not stored on the card; it is enrolled in the
+// CardDirectory as a salted hash.
 class Card{
   private:
     string cardNumber;
-    int pin;
     string accountNumber;
 
   public:
-    Card(string cardNumber, int pin, string accountNumber) : 
-      cardNumber(cardNumber), pin(pin), accountNumber(accountNumber) {};
+    Card(string cardNumber, string accountNumber) : 
+      cardNumber(cardNumber), accountNumber(accountNumber) {};
 
     string getAccountNumber(){
       return this->accountNumber;
     }
 
-    bool validatePin(int pin){
-      return this->pin == pin;
+    const string& getCardNumber(){
+      return this->cardNumber;
     }
 };
 
+enum HistoryEntryType : uint8_t{
+  HISTORY_WITHDRAWAL,
+  HISTORY_DEPOSIT
+};
+
+struct HistoryEntry{
+  int64_t timestamp;   // seconds since the epoch
+  HistoryEntryType type;
+  Money amount;
+  uint32_t atmId;
+};
+
+// Append-only statement of one account, stored column by
+// column (about 29 bytes a row, no strings). Timestamps never
+// decrease, so a time range is two binary searches, and a
+// running total of withdrawals turns "withdrawn between" into
+// one subtraction.
+class AccountHistory{
+  private:
+    mutable mutex lock;
+    vector<int64_t> timestamps;
+    vector<HistoryEntryType> types;
+    vector<int64_t> amountsInPaise;
+    vector<uint32_t> atmIds;
+    vector<int64_t> withdrawnBefore;   // withdrawals in rows [0, i)
+
+    size_t firstAtOrAfter(int64_t timestamp) const {
+      return lower_bound(timestamps.begin(), timestamps.end(), timestamp) - timestamps.begin();
+    }
+
+  public:
+    void reserve(size_t rows){
+      lock_guard<mutex> guard(lock);
+      timestamps.reserve(rows);
+      types.reserve(rows);
+      amountsInPaise.reserve(rows);
+      atmIds.reserve(rows);
+      withdrawnBefore.reserve(rows + 1);
+    }
+
+    // A timestamp older than the last row (clock skew between
+    // ATMs) is recorded at the last row's time.
+    void append(int64_t timestamp, HistoryEntryType type, Money amount, uint32_t atmId){
+      lock_guard<mutex> guard(lock);
+      if(!timestamps.empty() && timestamp < timestamps.back())
+        timestamp = timestamps.back();
+      if(withdrawnBefore.empty())
+        withdrawnBefore.push_back(0);
+      timestamps.push_back(timestamp);
+      types.push_back(type);
+      amountsInPaise.push_back(amount.inMinor());
+      atmIds.push_back(atmId);
+      withdrawnBefore.push_back(withdrawnBefore.back()
+          + (type == HISTORY_WITHDRAWAL ? amount.inMinor() : 0));
+    }
+
+    size_t size() const {
+      lock_guard<mutex> guard(lock);
+      return timestamps.size();
+    }
+
+    // Up to `count` most recent rows, newest first.
+    vector<HistoryEntry> lastEntries(size_t count) const {
+      lock_guard<mutex> guard(lock);
+      vector<HistoryEntry> rows;
+      size_t total = timestamps.size();
+      for(size_t i = total; i > 0 && rows.size() < count; i--)
+        rows.push_back(HistoryEntry{timestamps[i - 1], types[i - 1],
+                                    Money::fromMinor(amountsInPaise[i - 1]), atmIds[i - 1]});
+      return rows;
+    }
+
+    // Total withdrawn in [from, to).
+    Money withdrawnBetween(int64_t from, int64_t to) const {
+      lock_guard<mutex> guard(lock);
+      if(timestamps.empty() || from >= to) return Money();
+      return Money::fromMinor(withdrawnBefore[firstAtOrAfter(to)]
+                              - withdrawnBefore[firstAtOrAfter(from)]);
+    }
+};
+
+// Balance is a Money amount (integer paise) updated with
+// CAS, so two ATMs debiting the same account at once can
+// never take it below zero, and every debit is exact.
+//
+// The daily withdrawal limit is checked against a running
+// total for the current day, kept in one atomic word (day
+// number in the top 24 bits, paise in the low 40), so it is
+// reserved with a single CAS and never needs the history.
 class Account{
   private:
+    static constexpr int DAY_SHIFT = 40;
+    static constexpr int64_t TODAY_MASK = (int64_t(1) << DAY_SHIFT) - 1;
+
     string accountNumber;
-    double balance;
+    atomic<int64_t> balanceInPaise;
+    atomic<int64_t> dailyLimitInPaise;   // 0 = no limit
+    atomic<int64_t> withdrawnToday;      // day << DAY_SHIFT | paise
+    AccountHistory history;
+
   public:
-    Account(string accountNumber, double balance) : 
-      accountNumber(accountNumber), balance(balance) {};
+    static constexpr int64_t SECONDS_PER_DAY = 86400;
+
+    Account(string accountNumber, Money balance) : 
+      accountNumber(accountNumber), balanceInPaise(balance.inMinor()),
+      dailyLimitInPaise(0), withdrawnToday(0) {};
 
     string getAccountNumber(){
       return accountNumber;
     }
 
-    double getBalance(){
-      return balance;
+    Money getBalance(){
+      return Money::fromMinor(balanceInPaise.load());
     }
 
-    bool withdraw(double amount){
-      if(amount <= balance){
-        balance -= amount;
-        return true;
+    // False if the balance is short or `amount` is not positive
+    // (a negative withdrawal would be a deposit).
+    bool withdraw(Money amount){
+      if(amount <= Money()) return false;
+      int64_t current = balanceInPaise.load();
+      while(amount.inMinor() <= current){
+        if(balanceInPaise.compare_exchange_weak(
+             current, (Money::fromMinor(current) - amount).inMinor()))
+          return true;
       }
       return false;
     }
 
-    void deposit(double amount){
-      balance += amount;
+    // False if `amount` is not positive.
+    bool deposit(Money amount){
+      if(amount <= Money()) return false;
+      int64_t current = balanceInPaise.load();
+      while(!balanceInPaise.compare_exchange_weak(
+              current, (Money::fromMinor(current) + amount).inMinor())) {}
+      return true;
+    }
+
+    AccountHistory& getHistory(){
+      return history;
+    }
+
+    // Zero removes the limit; limits are capped at 2^40 paise.
+    void setDailyLimit(Money limit){
+      dailyLimitInPaise.store(min(limit.inMinor(), TODAY_MASK));
+    }
+
+    Money getDailyLimit(){
+      return Money::fromMinor(dailyLimitInPaise.load());
+    }
+
+    Money withdrawnOnDay(int64_t day){
+      int64_t word = withdrawnToday.load();
+      return Money::fromMinor((word >> DAY_SHIFT) == day ? (word & TODAY_MASK) : 0);
+    }
+
+    // Counts `amount` against the limit for `day`, which starts
+    // from zero the first time a new day is seen. False if it
+    // would exceed the limit, or is not a positive amount (a
+    // negative one would borrow into the day bits).
+    bool reserveDailyWithdrawal(Money amount, int64_t day){
+      if(amount.inMinor() <= 0)
+        return false;
+      int64_t limit = dailyLimitInPaise.load();
+      int64_t current = withdrawnToday.load();
+      while(true){
+        int64_t used = ((current >> DAY_SHIFT) == day) ? (current & TODAY_MASK) : 0;
+        int64_t next = used + amount.inMinor();
+        if(limit != 0 ? next > limit : next > TODAY_MASK)
+          return false;
+        if(withdrawnToday.compare_exchange_weak(current, (day << DAY_SHIFT) | next))
+          return true;
+      }
+    }
+
+    // Gives back a reservation whose withdrawal did not go through.
+    void releaseDailyWithdrawal(Money amount, int64_t day){
+      int64_t current = withdrawnToday.load();
+      while((current >> DAY_SHIFT) == day){
+        int64_t used = max<int64_t>(0, (current & TODAY_MASK) - amount.inMinor());
+        if(withdrawnToday.compare_exchange_weak(current, (day << DAY_SHIFT) | used))
+          return;
+      }
+    }
+};
+
+// Shared account store for many ATMMachines. Lookups lock
+// only one of STRIPES maps (picked by account number hash);
+// balance updates themselves are lock-free on the Account.
+class AccountLedger{
+  private:
+    static const int STRIPES = 64;
+
+    struct Stripe{
+      mutex lock;
+      unordered_map<string, Account*> accounts;
+    };
+
+    Stripe stripes[STRIPES];
+
+    Stripe& stripeFor(const string& accountNumber){
+      return stripes[hash<string>{}(accountNumber) % STRIPES];
+    }
+
+  public:
+    void addAccount(Account* account){
+      Stripe& stripe = stripeFor(account->getAccountNumber());
+      lock_guard<mutex> guard(stripe.lock);
+      stripe.accounts[account->getAccountNumber()] = account;
+    }
+
+    Account* findAccount(const string& accountNumber){
+      Stripe& stripe = stripeFor(accountNumber);
+      lock_guard<mutex> guard(stripe.lock);
+      auto it = stripe.accounts.find(accountNumber);
+      return it == stripe.accounts.end() ? nullptr : it->second;
+    }
+};
+
+/* ---------------- CARD DIRECTORY ----------------
+ Bank-side record of every card: a salted PIN hash (the PIN
+ itself is never stored), a failed-attempt counter that
+ blocks the card after MAX_PIN_ATTEMPTS, and the account the
+ card draws on, resolved once at enrolment. Authenticating
+ therefore also resolves the account, in one lookup.
+
+ Records live in STRIPES hash maps like the AccountLedger.
+ In front of them sits a direct-mapped hot cache holding a
+ copy of each recently used card (number, salt, hash,
+ account, and a pointer to its attempt counter) in one
+ cache line, read without locks under a per-slot sequence
+ number. Only cards with no failed attempts are cached and
+ a failed attempt evicts the card, but a cache hit still
+ reads the card's attempt counter and falls back to the
+ locked path unless it is zero, so lockout never depends on
+ the eviction winning a race.
+*/
+
+enum AuthResult{
+  AUTH_OK,
+  AUTH_WRONG_PIN,
+  AUTH_BLOCKED,
+  AUTH_UNKNOWN_CARD
+};
+
+struct AuthOutcome{
+  AuthResult result;
+  Account* account;    // set only for AUTH_OK
+};
+
+class CardDirectory{
+  public:
+    static const int MAX_PIN_ATTEMPTS = 3;
+
+  private:
+    static const int STRIPES = 64;
+    static const int HOT_SLOTS = 1 << 16;
+
+    struct CardRecord{
+      uint64_t salt;
+      uint64_t pinHash;
+      Account* account;
+      atomic<int> failedAttempts;
+    };
+
+    struct Stripe{
+      mutex lock;
+      unordered_map<string, CardRecord> cards;
+    };
+
+    // Odd sequence = being rewritten; readers retry via the maps.
+    struct alignas(64) HotCard{
+      atomic<uint32_t> sequence;
+      atomic<uint64_t> number[2];     // card number, zero padded
+      atomic<uint64_t> salt;
+      atomic<uint64_t> pinHash;
+      atomic<Account*> account;
+      atomic<atomic<int>*> failedAttempts;   // the record's counter
+    };
+
+    Stripe stripes[STRIPES];
+    HotCard* hotCards;
+    mt19937_64 saltSource;
+
+    // Keyed mix of salt and PIN. A deployment would check PINs
+    // in an HSM with a deliberately slow KDF; the record layout
+    // stays the same.
+    static uint64_t hashPin(uint64_t salt, int pin){
+      uint64_t h = salt ^ ((uint64_t)(uint32_t)pin * 0x9E3779B97F4A7C15ULL);
+      for(int round = 0; round < 4; round++){
+        h ^= h >> 31;
+        h *= 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 29;
+      }
+      return h;
+    }
+
+    // Card numbers of up to 16 characters fit in a hot slot.
+    static bool packNumber(const string& cardNumber, uint64_t packed[2]){
+      if(cardNumber.empty() || cardNumber.size() > 16) return false;
+      char buffer[16] = {};
+      memcpy(buffer, cardNumber.data(), cardNumber.size());
+      memcpy(packed, buffer, 16);
+      return true;
+    }
+
+    bool readHot(HotCard& slot, const uint64_t number[2], CardRecord& copy,
+                 atomic<int>*& failedAttempts){
+      uint32_t before = slot.sequence.load(memory_order_acquire);
+      if(before & 1) return false;
+      bool same = slot.number[0].load(memory_order_relaxed) == number[0]
+               && slot.number[1].load(memory_order_relaxed) == number[1];
+      copy.salt = slot.salt.load(memory_order_relaxed);
+      copy.pinHash = slot.pinHash.load(memory_order_relaxed);
+      copy.account = slot.account.load(memory_order_relaxed);
+      failedAttempts = slot.failedAttempts.load(memory_order_relaxed);
+      atomic_thread_fence(memory_order_acquire);
+      return same && slot.sequence.load(memory_order_relaxed) == before;
+    }
+
+    // Caching is skipped if another thread holds the slot;
+    // clearing (`record` null) waits for it.
+    void writeHot(HotCard& slot, const uint64_t number[2], const CardRecord* record,
+                  atomic<int>* failedAttempts = nullptr){
+      uint32_t sequence = slot.sequence.load(memory_order_relaxed);
+      while((sequence & 1) || !slot.sequence.compare_exchange_weak(sequence, sequence + 1)){
+        if(record) return;
+        sequence = slot.sequence.load(memory_order_relaxed);
+      }
+      atomic_thread_fence(memory_order_release);
+      slot.number[0].store(record ? number[0] : 0, memory_order_relaxed);
+      slot.number[1].store(record ? number[1] : 0, memory_order_relaxed);
+      if(record){
+        slot.salt.store(record->salt, memory_order_relaxed);
+        slot.pinHash.store(record->pinHash, memory_order_relaxed);
+        slot.account.store(record->account, memory_order_relaxed);
+        slot.failedAttempts.store(failedAttempts, memory_order_relaxed);
+      }
+      slot.sequence.store(sequence + 2, memory_order_release);
+    }
+
+    // Copies the record's fields while holding the stripe lock,
+    // since enroll() may be rewriting them, and returns its
+    // (atomic) attempt counter; null for an unknown card.
+    atomic<int>* findRecord(const string& cardNumber, size_t numberHash, CardRecord& copy){
+      Stripe& stripe = stripes[numberHash % STRIPES];
+      lock_guard<mutex> guard(stripe.lock);
+      auto it = stripe.cards.find(cardNumber);
+      if(it == stripe.cards.end()) return nullptr;
+      copy.salt = it->second.salt;
+      copy.pinHash = it->second.pinHash;
+      copy.account = it->second.account;
+      return &it->second.failedAttempts;
+    }
+
+  public:
+    CardDirectory() : hotCards(new HotCard[HOT_SLOTS]), saltSource(random_device{}()) {
+      for(int i = 0; i < HOT_SLOTS; i++){
+        hotCards[i].sequence.store(0);
+        hotCards[i].number[0].store(0);
+        hotCards[i].number[1].store(0);
+        hotCards[i].failedAttempts.store(nullptr);
+      }
+    }
+
+    ~CardDirectory(){
+      delete[] hotCards;
+    }
+
+    void reserve(size_t cardCount){
+      for(Stripe& stripe : stripes)
+        stripe.cards.reserve(cardCount / STRIPES + 1);
+    }
+
+    void enroll(const string& cardNumber, int pin, Account* account){
+      size_t numberHash = hash<string>{}(cardNumber);
+      uint64_t number[2];
+      if(packNumber(cardNumber, number))
+        writeHot(hotCards[numberHash % HOT_SLOTS], number, nullptr);
+
+      Stripe& stripe = stripes[numberHash % STRIPES];
+      lock_guard<mutex> guard(stripe.lock);
+      CardRecord& record = stripe.cards[cardNumber];
+      record.salt = saltSource();
+      record.pinHash = hashPin(record.salt, pin);
+      record.account = account;
+      record.failedAttempts.store(0);
+    }
+
+    AuthOutcome authenticate(const string& cardNumber, int pin){
+      size_t numberHash = hash<string>{}(cardNumber);
+      HotCard& slot = hotCards[numberHash % HOT_SLOTS];
+      uint64_t number[2];
+      bool cacheable = packNumber(cardNumber, number);
+
+      // Records are never erased, so the cached counter pointer
+      // stays valid; any failure sends us down the locked path.
+      CardRecord hot;
+      atomic<int>* hotAttempts = nullptr;
+      if(cacheable && readHot(slot, number, hot, hotAttempts)
+         && hotAttempts && hotAttempts->load(memory_order_acquire) == 0
+         && hashPin(hot.salt, pin) == hot.pinHash)
+        return {AUTH_OK, hot.account};
+
+      CardRecord record;
+      atomic<int>* failedAttempts = findRecord(cardNumber, numberHash, record);
+      if(!failedAttempts)
+        return {AUTH_UNKNOWN_CARD, nullptr};
+      if(failedAttempts->load() >= MAX_PIN_ATTEMPTS)
+        return {AUTH_BLOCKED, nullptr};
+
+      if(hashPin(record.salt, pin) != record.pinHash){
+        if(cacheable) writeHot(slot, number, nullptr);
+        int failures = failedAttempts->fetch_add(1) + 1;
+        return {failures >= MAX_PIN_ATTEMPTS ? AUTH_BLOCKED : AUTH_WRONG_PIN, nullptr};
+      }
+
+      if(failedAttempts->load() != 0)
+        failedAttempts->store(0);
+      if(cacheable){
+        writeHot(slot, number, &record, failedAttempts);
+        // A failure may have landed while we were caching.
+        if(failedAttempts->load() != 0)
+          writeHot(slot, number, nullptr);
+      }
+      return {AUTH_OK, record.account};
+    }
+
+    // Bank-side reset after the customer proves identity.
+    void unblock(const string& cardNumber){
+      CardRecord record;
+      atomic<int>* failedAttempts = findRecord(cardNumber, hash<string>{}(cardNumber), record);
+      if(failedAttempts) failedAttempts->store(0);
     }
 };
 
@@ -144,107 +596,800 @@ enum OperationType{
   BALANCE_INQUIRY
 };
 
+const int DENOMINATION_COUNT = 6;
+
+// Cassette order used by every per-denomination array.
+const CashType DENOMINATIONS[DENOMINATION_COUNT] = {
+  CashType::BILL_100,
+  CashType::BILL_50,
+  CashType::BILL_20,
+  CashType::BILL_10,
+  CashType::BILL_5,
+  CashType::BILL_1
+};
+
+int denominationIndex(CashType type){
+  switch(type){
+    case BILL_100: return 0;
+    case BILL_50:  return 1;
+    case BILL_20:  return 2;
+    case BILL_10:  return 3;
+    case BILL_5:   return 4;
+    default:       return 5;
+  }
+}
+
+// Notes per denomination, indexed like DENOMINATIONS.
+struct CashBundle{
+  int notes[DENOMINATION_COUNT] = {0, 0, 0, 0, 0, 0};
+
+  bool empty() const {
+    for(int count : notes)
+      if(count > 0) return false;
+    return true;
+  }
+
+  int noteCount() const {
+    int total = 0;
+    for(int count : notes) total += count;
+    return total;
+  }
+};
+
+// Notes paid out per denomination, in hourly buckets kept
+// in a ring of BUCKETS hours. Recording is one atomic add per
+// denomination. The ATM that owns the inventory moves it to
+// the hour of its own clock (ATMMachine::now()) before each
+// dispense; advanceTo() clears the buckets it moves into
+// before they are written. Readers on other threads check
+// a bucket's hour before and after reading its counts.
+class DispenseTelemetry{
+  public:
+    static const int BUCKETS = 48;
+    static constexpr int64_t SECONDS_PER_HOUR = 3600;
+
+  private:
+    struct Bucket{
+      atomic<long long> hour;
+      atomic<int> notes[DENOMINATION_COUNT];
+    };
+
+    Bucket buckets[BUCKETS];
+    atomic<long long> currentHour;
+
+  public:
+    DispenseTelemetry() : currentHour(0) {
+      for(Bucket& bucket : buckets){
+        bucket.hour.store(-1);
+        for(auto& count : bucket.notes)
+          count.store(0);
+      }
+      buckets[0].hour.store(0);
+    }
+
+    long long getCurrentHour(){
+      return currentHour.load(memory_order_acquire);
+    }
+
+    void advanceTo(long long hour){
+      long long from = currentHour.load(memory_order_relaxed);
+      for(long long h = max(from + 1, hour - BUCKETS + 1); h <= hour; h++){
+        Bucket& bucket = buckets[h % BUCKETS];
+        // Retire the bucket before clearing it, so a reader
+        // never pairs the new hour with the old counts.
+        bucket.hour.store(-1, memory_order_release);
+        for(auto& count : bucket.notes)
+          count.store(0, memory_order_relaxed);
+        bucket.hour.store(h, memory_order_release);
+      }
+      if(hour > from)
+        currentHour.store(hour, memory_order_release);
+    }
+
+    void record(const CashBundle& bundle){
+      Bucket& bucket = buckets[getCurrentHour() % BUCKETS];
+      for(int i = 0; i < DENOMINATION_COUNT; i++)
+        if(bundle.notes[i])
+          bucket.notes[i].fetch_add(bundle.notes[i], memory_order_relaxed);
+    }
+
+    // Notes of one denomination paid out during `hour`; zero
+    // once that hour has fallen out of the ring.
+    int notesDuring(long long hour, int denomination){
+      if(hour < 0) return 0;
+      const Bucket& bucket = buckets[hour % BUCKETS];
+      if(bucket.hour.load(memory_order_acquire) != hour) return 0;
+      int notes = bucket.notes[denomination].load(memory_order_acquire);
+      // Reused for a newer hour while we read: ours is gone.
+      if(bucket.hour.load(memory_order_acquire) != hour) return 0;
+      return notes;
+    }
+};
+
+enum DispenseMode{
+  FEWEST_NOTES,     // minimize the number of notes handed out
+  BALANCE_WEAR      // prefer cassettes that are still well stocked
+};
+
+// Cassette counts are per-denomination atomics and the
+// total cash value is maintained incrementally, so balance
+// checks are O(1) and an operator refill can run while a
+// withdrawal is being dispensed.
 class ATMInventory{
   private:
-    unordered_map<CashType, int>cashInventory;
+    atomic<int> cashInventory[DENOMINATION_COUNT];
+    atomic<long long> totalCash;
+    DispenseTelemetry telemetry;
 
   public:
-    ATMInventory(){
-      cashInventory[CashType::BILL_100] = 10;
-      cashInventory[CashType::BILL_50] = 10;
-      cashInventory[CashType::BILL_20] = 20;
-      cashInventory[CashType::BILL_10] = 30;
-      cashInventory[CashType::BILL_5] = 20;
-      cashInventory[CashType::BILL_1] = 50;
+    ATMInventory() : totalCash(0) {
+      for(auto& count : cashInventory)
+        count.store(0);
+      loadCassette(BILL_100, 10);
+      loadCassette(BILL_50, 10);
+      loadCassette(BILL_20, 20);
+      loadCassette(BILL_10, 30);
+      loadCassette(BILL_5, 20);
+      loadCassette(BILL_1, 50);
     }
 
-    bool hasSufficientCash(int amount){
-      int value = 0;
-      for(auto it : cashInventory)
-        value += static_cast<int>(it.first) * it.second;
-      return value >= amount;
+    int getNotes(CashType type){
+      return cashInventory[denominationIndex(type)].load();
     }
 
-    unordered_map<CashType, int> dispenseCash(int amount){
+    DispenseTelemetry& getTelemetry(){
+      return telemetry;
+    }
+
+    // Operator loads a cassette with exactly `count` notes.
+    void loadCassette(CashType type, int count){
+      int previous = cashInventory[denominationIndex(type)].exchange(count);
+      totalCash.fetch_add((long long)(count - previous) * static_cast<int>(type));
+    }
+
+    // Operator tops a cassette up by `count` notes.
+    void refill(CashType type, int count){
+      cashInventory[denominationIndex(type)].fetch_add(count);
+      totalCash.fetch_add((long long)count * static_cast<int>(type));
+    }
+
+    bool hasSufficientCash(Money amount){
+      return amount <= getTotalCash();
+    }
 
-      unordered_map<CashType, int>dispensed;
+    Money getTotalCash(){
+      return Money::rupees(totalCash.load());
+    }
+
+    // Full recount, for audits (and to compare against the cached total).
+    Money countTotalCash(){
+      long long value = 0;
+      for(int i = 0; i < DENOMINATION_COUNT; i++)
+        value += (long long)static_cast<int>(DENOMINATIONS[i]) * cashInventory[i].load();
+      return Money::rupees(value);
+    }
+
+    // Takes the planned notes out of the cassettes, or takes
+    // nothing if another withdrawal got to them first.
+    bool reserveCash(const CashBundle& plan){
+      int i = 0;
+      for(; i < DENOMINATION_COUNT; i++){
+        int need = plan.notes[i];
+        if(need == 0) continue;
+        int current = cashInventory[i].load();
+        while(current >= need
+              && !cashInventory[i].compare_exchange_weak(current, current - need)) {}
+        if(current < need) break;
+      }
+      if(i < DENOMINATION_COUNT){
+        for(int j = 0; j < i; j++)
+          cashInventory[j].fetch_add(plan.notes[j]);
+        return false;
+      }
+      long long value = 0;
+      for(int j = 0; j < DENOMINATION_COUNT; j++)
+        value += (long long)plan.notes[j] * static_cast<int>(DENOMINATIONS[j]);
+      totalCash.fetch_sub(value);
+      return true;
+    }
+
+    // Old largest-note-first plan. Can fail when a depleted
+    // cassette forces a different mix (e.g. 60 with no 10s
+    // left: 50 + ? fails, 20 + 20 + 20 works).
+    CashBundle planDispenseGreedy(int amount){
+      CashBundle plan;
       int remaining = amount;
+      for(int i = 0; i < DENOMINATION_COUNT; i++){
+        int value = static_cast<int>(DENOMINATIONS[i]);
+        int count = min(remaining / value, cashInventory[i].load());
+        plan.notes[i] = count;
+        remaining -= count * value;
+      }
+      return remaining == 0 ? plan : CashBundle();
+    }
 
-      CashType order[] = {
-        CashType::BILL_100,
-        CashType::BILL_50,
-        CashType::BILL_20,
-        CashType::BILL_10,
-        CashType::BILL_5,
-        CashType::BILL_1
-      };
+    // Bounded knapsack over the current cassettes: finds a mix
+    // whenever one exists, at the lowest total cost. Each
+    // cassette is split into 1, 2, 4, ... note packs so the
+    // DP stays O(amount * sum(log notes)). Works on a snapshot
+    // of the cassettes; reserveCash() confirms it.
+    //
+    // For FEWEST_NOTES, largest-note-first is tried first: with
+    // these note values it is optimal unless a cassette runs
+    // short, so the DP only runs when one does.
+    CashBundle planDispense(int amount, DispenseMode mode = FEWEST_NOTES){
+      if(amount <= 0 || totalCash.load() < amount)
+        return CashBundle();
+
+      int snapshot[DENOMINATION_COUNT];
+      for(int i = 0; i < DENOMINATION_COUNT; i++)
+        snapshot[i] = cashInventory[i].load();
+
+      if(mode == FEWEST_NOTES){
+        CashBundle plan;
+        int remaining = amount;
+        bool capped = false;
+        for(int i = 0; i < DENOMINATION_COUNT; i++){
+          int value = static_cast<int>(DENOMINATIONS[i]);
+          int wanted = remaining / value;
+          plan.notes[i] = min(wanted, snapshot[i]);
+          capped |= plan.notes[i] < wanted;
+          remaining -= plan.notes[i] * value;
+        }
+        if(!capped)
+          return plan;
+      }
 
-      for(CashType type : order){
-        int value = static_cast<int>(type);
-        int count = min(remaining/value, cashInventory[type]);
+      // Scratch space, reused between calls on the same thread.
+      static thread_local vector<int> minCost;
+      static thread_local vector<uint8_t> taken;
+
+      int packDenom[DENOMINATION_COUNT * 32];
+      int packNotes[DENOMINATION_COUNT * 32];
+      int packCount = 0;
+      int unitCost[DENOMINATION_COUNT];
+
+      for(int i = 0; i < DENOMINATION_COUNT; i++){
+        unitCost[i] = (mode == FEWEST_NOTES) ? 1 : 1 + 100 / (snapshot[i] + 1);
+        int left = min(snapshot[i], amount / static_cast<int>(DENOMINATIONS[i]));
+        for(int pack = 1; left > 0; pack *= 2){
+          int notes = min(pack, left);
+          packDenom[packCount] = i;
+          packNotes[packCount] = notes;
+          packCount++;
+          left -= notes;
+        }
+      }
 
-        if(count > 0){
-          dispensed[type] = count;
-          remaining -= count * value;
-          cashInventory[type] -= count;
+      const int INF = 1 << 29;
+      int width = amount + 1;
+      minCost.assign(width, INF);
+      taken.assign((size_t)packCount * width, 0);
+      minCost[0] = 0;
+
+      for(int p = 0; p < packCount; p++){
+        int value = packNotes[p] * static_cast<int>(DENOMINATIONS[packDenom[p]]);
+        int cost = packNotes[p] * unitCost[packDenom[p]];
+        uint8_t* row = &taken[(size_t)p * width];
+        for(int v = amount; v >= value; v--){
+          if(minCost[v - value] + cost < minCost[v]){
+            minCost[v] = minCost[v - value] + cost;
+            row[v] = 1;
+          }
         }
       }
 
-      if(remaining > 0){
-        for(auto type : dispensed)
-          cashInventory[type.first] += type.second;
-        return {};
+      if(minCost[amount] >= INF)
+        return CashBundle();
+
+      CashBundle plan;
+      int v = amount;
+      for(int p = packCount - 1; p >= 0; p--){
+        if(taken[(size_t)p * width + v]){
+          plan.notes[packDenom[p]] += packNotes[p];
+          v -= packNotes[p] * static_cast<int>(DENOMINATIONS[packDenom[p]]);
+        }
+      }
+      return plan;
+    }
+
+    // Removes the planned notes; empty bundle = cannot dispense
+    // (including amounts with paise, which no note can pay).
+    // Re-plans a few times if a concurrent withdrawal took the
+    // notes between planning and reserving.
+    CashBundle dispenseCash(Money amount, DispenseMode mode = FEWEST_NOTES){
+      if(!amount.isWholeRupees() || amount > getTotalCash())
+        return CashBundle();
+      int rupees = (int)amount.wholeRupees();
+      for(int attempt = 0; attempt < 3; attempt++){
+        CashBundle plan = planDispense(rupees, mode);
+        if(plan.empty())
+          return plan;
+        if(reserveCash(plan)){
+          telemetry.record(plan);
+          return plan;
+        }
       }
-      return dispensed;
+      return CashBundle();
     }
 };
 
-class ATMState;
+/* ---------------- REPLENISHMENT FORECAST ----------------
+ Predicts when each cassette runs dry from its dispense
+ telemetry. Every ATM has a Tracker holding an exponentially
+ weighted notes-per-hour rate and variance per denomination;
+ a forecast folds in only the hours that closed since the
+ previous forecast, so re-forecasting a fleet every hour
+ costs a few multiplies per ATM.
+
+ Demand is bursty, so the forecast is the hour by which the
+ cassette is empty with `safetySigmas` of headroom: the
+ H at which rate*H + z*sigma*sqrt(H) reaches notes, i.e. the
+ positive root of rate*x^2 + z*sigma*x - notes with H = x^2.
+*/
+
+struct CassetteForecast{
+  double notesPerHour[DENOMINATION_COUNT];
+  double hoursUntilEmpty[DENOMINATION_COUNT];   // with safety margin; infinity if idle
+  int firstToEmpty;                             // denomination index, -1 if none
+  double hoursUntilRefill;                      // hours until that one is empty
+};
+
+class ReplenishmentForecaster{
+  public:
+    struct Tracker{
+      long long foldedThrough = -1;   // last closed hour already folded in
+      double notesPerHour[DENOMINATION_COUNT] = {};
+      double variance[DENOMINATION_COUNT] = {};   // of notes per hour
+      int hoursSeen = 0;
+    };
 
-class ATMMachine{
   private:
-    unordered_map<string, Account*>accounts;
+    double smoothing;
+    double safetySigmas;
+    vector<Tracker> fleetTrackers;
+
+    double hoursUntilEmpty(int notes, double rate, double variance){
+      if(rate <= 1e-6) return INFINITY;
+      double spread = safetySigmas * sqrt(variance);
+      double root = (-spread + sqrt(spread * spread + 4 * rate * notes)) / (2 * rate);
+      return root * root;
+    }
 
-    ATMState* currentState;
+  public:
+    ReplenishmentForecaster(double smoothing = 0.2, double safetySigmas = 2.0)
+      : smoothing(smoothing), safetySigmas(safetySigmas) {}
+
+    CassetteForecast forecast(ATMInventory& inventory, Tracker& tracker){
+      DispenseTelemetry& telemetry = inventory.getTelemetry();
+      long long lastClosed = telemetry.getCurrentHour() - 1;
+      long long from = max(tracker.foldedThrough + 1, lastClosed - DispenseTelemetry::BUCKETS + 1);
+      for(long long hour = from; hour <= lastClosed; hour++){
+        // Average plainly until the window fills, so the first
+        // forecasts are not dragged toward the zero start.
+        double weight = max(smoothing, 1.0 / ++tracker.hoursSeen);
+        for(int i = 0; i < DENOMINATION_COUNT; i++){
+          double diff = telemetry.notesDuring(hour, i) - tracker.notesPerHour[i];
+          tracker.notesPerHour[i] += weight * diff;
+          tracker.variance[i] = (1 - weight) * (tracker.variance[i] + weight * diff * diff);
+        }
+      }
+      tracker.foldedThrough = max(tracker.foldedThrough, lastClosed);
+
+      CassetteForecast result;
+      result.firstToEmpty = -1;
+      result.hoursUntilRefill = INFINITY;
+      for(int i = 0; i < DENOMINATION_COUNT; i++){
+        double rate = tracker.notesPerHour[i];
+        int notes = inventory.getNotes(DENOMINATIONS[i]);
+        result.notesPerHour[i] = rate;
+        result.hoursUntilEmpty[i] = hoursUntilEmpty(notes, rate, tracker.variance[i]);
+        if(result.hoursUntilEmpty[i] < result.hoursUntilRefill){
+          result.hoursUntilRefill = result.hoursUntilEmpty[i];
+          result.firstToEmpty = i;
+        }
+      }
+      return result;
+    }
 
-    ATMState* idleState;
-    ATMState* hasCardState;
-    ATMState* pinValidationState;
-    ATMState* selectOperationState;
-    ATMState* transactionState;
+    // Forecasts every ATM; the fleet must keep its order
+    // between calls so each ATM keeps its tracker.
+    void forecastFleet(const vector<ATMInventory*>& fleet, vector<CassetteForecast>& out){
+      fleetTrackers.resize(fleet.size());
+      out.resize(fleet.size());
+      for(size_t i = 0; i < fleet.size(); i++)
+        out[i] = forecast(*fleet[i], fleetTrackers[i]);
+    }
+};
 
-    ATMInventory inventory;
-    Card* currentCard;
-    Account* currentAccount;
-    OperationType currentOperation;
+/* ---------------- TRANSACTION JOURNAL ----------------
+ Append-only log of every withdrawal, so a crash between the
+ debit and the dispense can be reconciled on restart:
+
+   INTENT      logged before the account is debited
+   DISPENSED   the notes left the cassettes
+   COMMITTED   the session finished
+   ROLLED_BACK the debit was undone (or never happened)
+
+ Each withdrawal carries an idempotency key; a request that
+ repeats a known key is ignored instead of paying out twice.
+ beginIntent() writes and fsyncs the INTENT (with anything
+ buffered before it) before it returns, so no account is
+ debited unless its INTENT is on disk; if that write fails
+ the withdrawal is refused. DISPENSED, COMMITTED
+ and ROLLED_BACK records are buffered and written with one
+ fwrite + fsync per groupCommitSize records. Each record has
+ a checksum, so a torn tail is detected and dropped on
+ recovery.
+
+ What a crash can still lose is a buffered DISPENSED: if the
+ notes left the cassettes but that record was not yet
+ written, recovery sees only the INTENT and rolls the debit
+ back, so the customer keeps cash that was never charged.
+ The bank's cassette count settles that case, not the
+ journal.
+*/
+
+enum TxnRecordType : uint8_t{
+  TXN_INTENT = 1,
+  TXN_DISPENSED = 2,
+  TXN_COMMITTED = 3,
+  TXN_ROLLED_BACK = 4
+};
+
+struct TxnRecord{
+  uint64_t key;
+  int64_t amountInPaise;
+  char account[12];
+  uint8_t type;
+  uint8_t reserved;
+  uint16_t checksum;
+
+  string accountNumber() const {
+    return string(account, strnlen(account, sizeof(account)));
+  }
+
+  uint16_t computeChecksum() const {
+    uint64_t h = key * 0x9E3779B97F4A7C15ULL ^ (uint64_t)amountInPaise ^ ((uint64_t)type << 56);
+    for(char c : account)
+      h = (h ^ (uint8_t)c) * 0x100000001B3ULL;
+    return static_cast<uint16_t>(h ^ (h >> 16) ^ (h >> 32) ^ (h >> 48));
+  }
+
+  bool isValid() const {
+    return type >= TXN_INTENT && type <= TXN_ROLLED_BACK && checksum == computeChecksum();
+  }
+};
+
+static_assert(sizeof(TxnRecord) == 32, "journal records must stay 32 bytes");
+
+struct RecoveryReport{
+  long long records = 0;
+  long long transactions = 0;
+  long long committed = 0;     // already finished before the crash
+  long long completed = 0;     // cash had left: debit kept, COMMITTED added
+  long long rolledBack = 0;    // no cash left: debit dropped
+  long long unapplied = 0;     // account missing or debit refused
+  bool written = true;         // false if the closing records did not reach the disk
+};
+
+enum IntentResult{
+  INTENT_LOGGED,      // durable: the caller may debit
+  INTENT_DUPLICATE,   // key already used
+  INTENT_NOT_LOGGED   // write failed: nothing may be debited
+};
+
+class ATMJournal{
+  private:
+    string path;
+    FILE* file;
+    vector<TxnRecord> pending;
+    size_t groupCommitSize;
+    unordered_set<uint64_t> knownKeys;
+    uint64_t nextKey;
+    mutex lock;
+
+    // Caller holds `lock`. On failure the batch stays pending
+    // and whatever part of it reached the file is cut off again,
+    // so later records are not hidden behind a torn one.
+    bool writePending(){
+      if(pending.empty()) return true;
+      if(!file) return false;
+      fseek(file, 0, SEEK_END);
+      long durableEnd = ftell(file);
+      bool ok = fwrite(pending.data(), sizeof(TxnRecord), pending.size(), file) == pending.size()
+             && fflush(file) == 0;
+#if defined(__unix__) || defined(__APPLE__)
+      ok = ok && fsync(fileno(file)) == 0;
+#endif
+      if(ok){
+        pending.clear();
+        return true;
+      }
+      cout << "[JOURNAL] Cannot write " << pending.size() << " records to " << path << endl;
+      fclose(file);   // drops what stdio still buffers
+#if defined(__unix__) || defined(__APPLE__)
+      struct stat written;
+      if(durableEnd >= 0
+         && stat(path.c_str(), &written) == 0 && written.st_size > durableEnd
+         && ::truncate(path.c_str(), durableEnd) != 0)
+        cout << "[JOURNAL] Cannot cut the failed batch off " << path << endl;
+#endif
+      file = fopen(path.c_str(), "ab");
+      return false;
+    }
+
+    static TxnRecord makeRecord(TxnRecordType type, uint64_t key,
+                                const string& accountNumber, Money amount){
+      TxnRecord record;
+      memset(&record, 0, sizeof(record));
+      record.key = key;
+      record.amountInPaise = amount.inMinor();
+      memcpy(record.account, accountNumber.data(),
+             min(accountNumber.size(), sizeof(record.account)));
+      record.type = type;
+      record.checksum = record.computeChecksum();
+      return record;
+    }
+
+    // Caller holds `lock`.
+    void appendLocked(const TxnRecord& record){
+      pending.push_back(record);
+      if(pending.size() >= groupCommitSize)
+        writePending();
+    }
+
+    // Rewrites the file without a torn tail, so records appended
+    // during recovery are not hidden behind it. False if the
+    // file could not be rewritten.
+    bool dropTornTail(const vector<TxnRecord>& intact){
+      lock_guard<mutex> guard(lock);
+      if(!file || fflush(file) != 0) return false;
+      fseek(file, 0, SEEK_END);
+      if(ftell(file) == (long)(intact.size() * sizeof(TxnRecord))) return true;
+
+      fclose(file);
+      file = fopen(path.c_str(), "wb");
+      bool ok = file
+             && fwrite(intact.data(), sizeof(TxnRecord), intact.size(), file) == intact.size()
+             && fflush(file) == 0;
+#if defined(__unix__) || defined(__APPLE__)
+      ok = ok && fsync(fileno(file)) == 0;
+#endif
+      if(file) ok = fclose(file) == 0 && ok;
+      file = fopen(path.c_str(), "ab");
+      if(!ok)
+        cout << "[JOURNAL] Cannot rewrite " << path << " without its torn tail" << endl;
+      return ok && file;
+    }
 
   public:
-    //GETTERS
-    ATMMachine();
+    ATMJournal(const string& path, size_t groupCommitSize = 64)
+      : path(path), groupCommitSize(groupCommitSize), nextKey(1) {
+      file = fopen(path.c_str(), "ab");
+      if(!file)
+        cout << "[JOURNAL] Cannot open " << path << endl;
+    }
+
+    ~ATMJournal(){
+      commit();
+      if(file) fclose(file);
+    }
 
-    ATMState* getCurrentState(){
-      return currentState;
+    uint64_t newKey(){
+      lock_guard<mutex> guard(lock);
+      while(knownKeys.count(nextKey)) nextKey++;
+      return nextKey++;
     }
 
-    ATMState* getIdleState(){
-      return idleState;
+    // Claims `key` and appends its INTENT under one lock, so two
+    // ATMs retrying the same request cannot both start it. On
+    // INTENT_LOGGED the INTENT is durable and the caller debits
+    // the account next. A failed write releases the key again.
+    IntentResult beginIntent(uint64_t key, const string& accountNumber, Money amount){
+      TxnRecord record = makeRecord(TXN_INTENT, key, accountNumber, amount);
+      lock_guard<mutex> guard(lock);
+      if(!knownKeys.insert(key).second)
+        return INTENT_DUPLICATE;
+      pending.push_back(record);
+      if(writePending())
+        return INTENT_LOGGED;
+      pending.pop_back();
+      knownKeys.erase(key);
+      return INTENT_NOT_LOGGED;
     }
 
-    ATMState* getHasCardState(){
-      return hasCardState;
+    void append(TxnRecordType type, uint64_t key, const string& accountNumber,
+                Money amount){
+      TxnRecord record = makeRecord(type, key, accountNumber, amount);
+      lock_guard<mutex> guard(lock);
+      if(type == TXN_INTENT)
+        knownKeys.insert(key);
+      appendLocked(record);
     }
 
-    ATMState* getSelectOperationState(){
-      return selectOperationState;
+    // Makes every appended record durable. False if the write
+    // failed; the records stay buffered for the next commit.
+    bool commit(){
+      lock_guard<mutex> guard(lock);
+      return writePending();
     }
 
-    ATMState* getPinValidationState(){
-      return pinValidationState;
+    // Every intact record, stopping at the first torn one.
+    vector<TxnRecord> readAll() const {
+      vector<TxnRecord> records;
+      FILE* in = fopen(path.c_str(), "rb");
+      if(!in) return records;
+
+      TxnRecord buffer[2048];
+      size_t read;
+      bool torn = false;
+      while(!torn && (read = fread(buffer, sizeof(TxnRecord), 2048, in)) > 0){
+        for(size_t i = 0; i < read; i++){
+          if(!buffer[i].isValid()){
+            torn = true;
+            break;
+          }
+          records.push_back(buffer[i]);
+        }
+      }
+      fclose(in);
+      return records;
     }
 
-    ATMState* getTransactionState(){
-      return transactionState;
+    // Replays the journal onto a ledger holding the balances
+    // from when the journal was started, and closes every
+    // transaction the crash left open. Replaying twice is
+    // harmless to the journal: closed keys stay closed.
+    RecoveryReport recover(AccountLedger& ledger){
+      RecoveryReport report;
+      vector<TxnRecord> records = readAll();
+      report.records = records.size();
+      report.written = dropTornTail(records);
+
+      struct Progress{
+        size_t intent;       // index of the INTENT record
+        uint8_t furthest;    // furthest TxnRecordType seen
+      };
+      unordered_map<uint64_t, Progress> progress;
+      progress.reserve(records.size() / 2 + 1);
+      vector<uint64_t> order;
+
+      for(size_t i = 0; i < records.size(); i++){
+        auto it = progress.find(records[i].key);
+        if(it == progress.end()){
+          if(records[i].type != TXN_INTENT) continue;
+          progress.emplace(records[i].key, Progress{i, TXN_INTENT});
+          order.push_back(records[i].key);
+        }
+        else if(records[i].type == TXN_ROLLED_BACK || records[i].type > it->second.furthest){
+          it->second.furthest = records[i].type;
+        }
+      }
+
+      {
+        lock_guard<mutex> guard(lock);
+        for(uint64_t key : order){
+          knownKeys.insert(key);
+          if(key >= nextKey) nextKey = key + 1;
+        }
+      }
+
+      for(uint64_t key : order){
+        const Progress& p = progress[key];
+        const TxnRecord& intent = records[p.intent];
+        string accountNumber = intent.accountNumber();
+        report.transactions++;
+
+        if(p.furthest == TXN_ROLLED_BACK) continue;
+        if(p.furthest == TXN_INTENT){
+          append(TXN_ROLLED_BACK, key, accountNumber, Money::fromMinor(intent.amountInPaise));
+          report.rolledBack++;
+          continue;
+        }
+
+        Account* account = ledger.findAccount(accountNumber);
+        if(!account || !account->withdraw(Money::fromMinor(intent.amountInPaise))){
+          report.unapplied++;
+          continue;
+        }
+        if(p.furthest == TXN_DISPENSED){
+          append(TXN_COMMITTED, key, accountNumber, Money::fromMinor(intent.amountInPaise));
+          report.completed++;
+        }
+        else report.committed++;
+      }
+      report.written = commit() && report.written;
+      return report;
     }
+};
+
+// One customer action. Sessions are driven by queues of these
+// instead of reading std::cin, so a test script or a network
+// front end can feed them and one thread can run many ATMs.
+enum ATMEventType{
+  CARD_INSERTED,      // card
+  OPERATION_SELECTED, // operation
+  NUMBER_ENTERED,     // value (PIN or amount)
+  CONFIRMED,          // run the selected transaction
+  CARD_REMOVED
+};
+
+const int ATM_EVENT_COUNT = CARD_REMOVED + 1;
+
+// Dense ids for the five ATM states, used by the transition table.
+enum ATMStateId{
+  IDLE,
+  HAS_CARD,
+  PIN_VALIDATION,
+  SELECT_OPERATION,
+  TRANSACTION
+};
+
+const int ATM_STATE_COUNT = TRANSACTION + 1;
+
+// Outcome of a step that may need input or may fail.
+enum StepResult{
+  STEP_DONE,    // move on to the next state
+  STEP_WAIT,    // stay: waiting for input, or the customer may retry
+  STEP_ABORT    // give up and return to Idle
+};
+
+struct ATMEvent{
+  ATMEventType type;
+  Card* card = nullptr;
+  OperationType operation = WITHDRAW;
+  int value = 0;
+  uint64_t requestKey = 0;   // CONFIRMED: idempotency key, 0 = new
+};
+
+// Per-machine outcome counters, bumped by the state steps.
+struct ATMCounters{
+  long long withdrawals = 0;       // withdrawals that paid out
+  long long amountDispensed = 0;   // Rs
+  long long cashShort = 0;         // "Not Sufficient Cash in Inventory"
+  long long balanceShort = 0;      // "Insufficient Balance in Your Account"
+  long long exactAmountFailed = 0; // "Cannot Dispense Exact Amount"
+  long long balanceInquiries = 0;
+  long long wrongPins = 0;
+  long long dailyLimitHit = 0;     // "Daily Withdrawal Limit Reached"
+};
+
+
+class ATMMachine{
+  private:
+    AccountLedger* ledger;
+
+    ATMStateId stateId;
+
+    ATMInventory inventory;
+    ATMJournal* journal;
+    uint64_t requestKey;
+    ATMCounters counters;
+    CardDirectory* cardDirectory;
+    uint32_t atmId;
+    int64_t pinnedClock;   // -1 = wall clock
+    Card* currentCard;
+    Account* currentAccount;
+    OperationType currentOperation;
+
+    // Events posted for this session, oldest first.
+    deque<ATMEvent> events;
+    // Numbers entered but not yet consumed by a state.
+    deque<int> pendingInput;
+    // Fall back to std::cin when no number is buffered.
+    bool consoleInput;
+    // A step ran out of input; the next number resumes it.
+    bool awaitingInput;
+    // Prompts and messages of the states; `silent` has no
+    // buffer, so writes to it are dropped.
+    ostream* output;
+    ostream silent;
+
+  public:
+    //GETTERS
+    ATMMachine();
+    ATMMachine(AccountLedger* sharedLedger, CardDirectory* sharedDirectory);
 
     Card* getCurrentCard(){
       return currentCard;
@@ -262,26 +1407,86 @@ class ATMMachine{
       return inventory;
     }
 
+    AccountLedger* getLedger(){
+      return ledger;
+    }
+
+    // Checks PINs and supplies the card's account.
+    CardDirectory* getCardDirectory(){
+      return cardDirectory;
+    }
+
+    // Issues `card` with `pin` for an account of this ATM's
+    // ledger; false if the ledger has no such account.
+    bool enrollCard(Card* card, int pin){
+      Account* account = ledger->findAccount(card->getAccountNumber());
+      if(!account) return false;
+      cardDirectory->enroll(card->getCardNumber(), pin, account);
+      return true;
+    }
+
+    void setAccount(Account* account){
+      currentAccount = account;
+    }
+
+    ATMCounters& getCounters(){
+      return counters;
+    }
+
+    ATMJournal* getJournal(){
+      return journal;
+    }
+
+    void attachJournal(ATMJournal* transactionJournal){
+      journal = transactionJournal;
+    }
+
+    uint32_t getAtmId(){
+      return atmId;
+    }
+
+    void setAtmId(uint32_t id){
+      atmId = id;
+    }
+
+    // Seconds since the epoch, stamped on statement rows and
+    // used to pick the day for the withdrawal limit.
+    int64_t now(){
+      return pinnedClock >= 0 ? pinnedClock : (int64_t)time(nullptr);
+    }
+
+    // Fixes the clock for simulations; -1 follows the wall clock.
+    void pinClock(int64_t seconds){
+      pinnedClock = seconds;
+    }
+
+    void setRequestKey(uint64_t key){
+      requestKey = key;
+    }
+
+    // Key for the withdrawal being run; a fresh one unless the
+    // request supplied its own.
+    uint64_t takeRequestKey(){
+      uint64_t key = requestKey;
+      requestKey = 0;
+      return key != 0 ? key : journal->newKey();
+    }
+
     //SETTERS
     void setCard(Card* card){
       currentCard = card;
     }
 
-    bool loadAccountFromCard(){
-      string accNo = currentCard->getAccountNumber();
-      if(accounts.count(accNo)){
-        currentAccount = accounts[accNo];
-        return true;
-      }
-      return false;
+    void addAccount(Account* account){
+      ledger->addAccount(account);
     }
 
-    void addAccount(Account* account){
-      accounts[account->getAccountNumber()] = account;
+    ATMStateId getStateId(){
+      return stateId;
     }
 
-    void setCurrentState(ATMState* state){
-      currentState = state;
+    void setCurrentState(ATMStateId id){
+      stateId = id;
     }
 
     void setOperation(OperationType operation){
@@ -291,213 +1496,830 @@ class ATMMachine{
     void clearSession(){
       currentCard = nullptr;
       currentAccount = nullptr;
+      pendingInput.clear();
+      awaitingInput = false;
     }
-};
 
-class ATMState{
-  public:
-    ~ATMState(){};
-    virtual ATMState* insertCard(ATMMachine*) = 0;
-    virtual ATMState* removeCard(ATMMachine*) = 0;
-    virtual ATMState* selectOperation(ATMMachine*, OperationType&) = 0;
-    virtual ATMState* transactionState(ATMMachine*) = 0;
-    virtual string getStateName() = 0;
-};
-
-class IdleState : public ATMState{
-  public:
-    ATMState* insertCard(ATMMachine* state) override {
-      cout<<"Card Inserted Successfully!!"<<endl;
-      return state->getHasCardState();
+    //INPUT
+    void setConsoleInput(bool enabled){
+      consoleInput = enabled;
     }
 
-    ATMState* removeCard(ATMMachine* state) override {
-      cout<<"Insert Card First"<<endl;
-      return this;
+    // nullptr mutes the session, e.g. for benchmarks.
+    void setOutput(ostream* stream){
+      output = stream ? stream : &silent;
     }
 
-    ATMState* selectOperation(ATMMachine* state, OperationType &operation) override {
-      cout<<"Insert Card First"<<endl;
-      return this;
+    ostream& out(){
+      return *output;
     }
 
-    ATMState* transactionState(ATMMachine* state) override {
-      cout<<"Select Operation First"<<endl;
-      return this;
+    void provideInput(int value){
+      pendingInput.push_back(value);
     }
 
-    string getStateName() override {
-      return "Idle_State";
+    // Next entered number; false means the session has to wait
+    // for a NUMBER_ENTERED event instead of blocking.
+    bool takeInput(int& value){
+      awaitingInput = false;
+      if(!pendingInput.empty()){
+        value = pendingInput.front();
+        pendingInput.pop_front();
+        return true;
+      }
+      if(consoleInput){
+        cin >> value;
+        return true;
+      }
+      awaitingInput = true;
+      return false;
     }
-};
 
-class HasCardState : public ATMState{
-  public:
-    ATMState* insertCard(ATMMachine* state) override {
-      cout<<"Card Already Inserted!!"<<endl;
-      return this;
+    bool isAwaitingInput(){
+      return awaitingInput;
     }
 
-    ATMState* removeCard(ATMMachine* state) override {
-      cout<<"Card Removed"<<endl;
-      return state->getIdleState();
+    void postEvent(const ATMEvent& event){
+      events.push_back(event);
     }
 
-    ATMState* selectOperation(ATMMachine* state, OperationType &operation) override {
-      cout<<"Proceeding to PIN Validation"<<endl;
-      return state->getPinValidationState();
+    bool hasPendingEvents(){
+      return !events.empty();
     }
 
-    ATMState* transactionState(ATMMachine* state) override {
-      cout<<"Select Operation First"<<endl;
-      return state->getIdleState();
+    // Pops the oldest posted event; false if there is none.
+    bool takeNextEvent(ATMEvent& event){
+      if(events.empty()) return false;
+      event = events.front();
+      events.pop_front();
+      return true;
     }
 
-    string getStateName() override {
-      return "Has_Card_State";
-    }
+    // Applies the oldest posted event to the current state
+    // through the compile-time ATMTable (StateMachine.h).
+    void processNextEvent();
 };
 
-class PinValidationState : public ATMState{
-  public:
-    ATMState* insertCard(ATMMachine* state) override {
-      cout<<"Card Already Inserted"<<endl;
-      return this;
+// PIN check for the operation already chosen; runs when the
+// operation is picked and again on every number entered.
+StepResult validatePinStep(ATMMachine* state){
+  int PIN;
+  state->out()<<"Enter PIN : ";
+  if(!state->takeInput(PIN))
+    return STEP_WAIT;
+
+  AuthOutcome outcome = state->getCardDirectory()->authenticate(state->getCurrentCard()->getCardNumber(), PIN);
+  switch(outcome.result){
+    case AUTH_OK:
+      state->setAccount(outcome.account);
+      return STEP_DONE;
+    case AUTH_WRONG_PIN:
+      state->getCounters().wrongPins++;
+      return STEP_WAIT;
+    case AUTH_BLOCKED:
+      state->out()<<"Card Blocked, Contact Your Bank"<<endl;
+      state->clearSession();
+      return STEP_ABORT;
+    case AUTH_UNKNOWN_CARD:
+      break;
+  }
+  state->out()<<"Account Not Found"<<endl;
+  state->clearSession();
+  return STEP_ABORT;
+}
+
+// Runs the selected operation; STEP_WAIT leaves the customer in
+// the transaction to try another amount.
+StepResult transactionStep(ATMMachine* state){
+  OperationType type = state->getCurrentOperation();
+
+  if (type == OperationType::WITHDRAW) {
+    int entered = 0;
+    state->out() << "Enter Amount To Withdraw : ";
+    if (!state->takeInput(entered))
+        return STEP_WAIT;
+    if (entered <= 0) {
+        state->out() << "Invalid Amount" << endl;
+        return STEP_WAIT;
     }
+    Money amount = Money::rupees(entered);
 
-    ATMState* removeCard(ATMMachine* state) override {
-      cout<<"Card Removed"<<endl;
-      return state->getIdleState();
+    Account* account = state->getCurrentAccount();
+
+    if (!state->getInventory().hasSufficientCash(amount)) {
+        state->out() << "Not Sufficient Cash in Inventory" << endl;
+        state->getCounters().cashShort++;
+        return STEP_WAIT;
     }
 
-    ATMState* selectOperation(ATMMachine* state, OperationType &operation) override {
-      int PIN;
-      cout<<"Enter PIN : ";
-      cin>>PIN;
+    int64_t timestamp = state->now();
+    int64_t day = timestamp / Account::SECONDS_PER_DAY;
+    if (!account->reserveDailyWithdrawal(amount, day)) {
+        state->out() << "Daily Withdrawal Limit Reached" << endl;
+        state->getCounters().dailyLimitHit++;
+        return STEP_WAIT;
+    }
 
-      if(state->getCurrentCard()->validatePin(PIN)){
-        if(!state->loadAccountFromCard()){
-          cout<<"Account Not Found"<<endl;
-          return state->getIdleState();
+    ATMJournal* journal = state->getJournal();
+    uint64_t key = 0;
+    if (journal) {
+        key = state->takeRequestKey();
+        IntentResult intent = journal->beginIntent(key, account->getAccountNumber(), amount);
+        if (intent == INTENT_DUPLICATE) {
+            account->releaseDailyWithdrawal(amount, day);
+            state->out() << "Duplicate Request Ignored" << endl;
+            state->clearSession();
+            return STEP_DONE;
         }
-        state->setOperation(operation);
-        return state->getSelectOperationState();
-      }
+        if (intent == INTENT_NOT_LOGGED) {
+            account->releaseDailyWithdrawal(amount, day);
+            state->out() << "Service Unavailable, No Cash Dispensed" << endl;
+            return STEP_WAIT;
+        }
+    }
 
-      return this;
+    // Check and debit in one atomic step: another ATM may
+    // be debiting the same account right now.
+    if (!account->withdraw(amount)) {
+        state->out() << "Insufficient Balance in Your Account" << endl;
+        state->getCounters().balanceShort++;
+        account->releaseDailyWithdrawal(amount, day);
+        if (journal) journal->append(TXN_ROLLED_BACK, key, account->getAccountNumber(), amount);
+        return STEP_WAIT;
     }
 
-    ATMState* transactionState(ATMMachine* state) override {
-      cout<<"Select Operation First"<<endl;
-      return this;
+    state->getInventory().getTelemetry().advanceTo(timestamp / DispenseTelemetry::SECONDS_PER_HOUR);
+    auto cash = state->getInventory().dispenseCash(amount);
+    if (cash.empty()) {
+        state->out() << "Cannot Dispense Exact Amount" << endl;
+        state->getCounters().exactAmountFailed++;
+        account->deposit(amount);   // rollback
+        account->releaseDailyWithdrawal(amount, day);
+        if (journal) journal->append(TXN_ROLLED_BACK, key, account->getAccountNumber(), amount);
+        return STEP_WAIT;
     }
 
-    string getStateName() override {
-      return "PIN_Validation_State";
+    if (journal) {
+        journal->append(TXN_DISPENSED, key, account->getAccountNumber(), amount);
+        journal->append(TXN_COMMITTED, key, account->getAccountNumber(), amount);
     }
+    account->getHistory().append(timestamp, HISTORY_WITHDRAWAL, amount, state->getAtmId());
+    state->out() << "Cash Dispensed Successfully" << endl;
+    state->getCounters().withdrawals++;
+    state->getCounters().amountDispensed += amount.wholeRupees();
+  }
+  else if (type == OperationType::BALANCE_INQUIRY) {
+      state->getCounters().balanceInquiries++;
+      state->out() << "Current Balance : "
+          << state->getCurrentAccount()->getBalance()
+          << endl;
+  }
+
+  state->clearSession();
+  return STEP_DONE;
+}
+
+ATMMachine::ATMMachine() : ATMMachine(new AccountLedger(), new CardDirectory()) {}
+
+ATMMachine::ATMMachine(AccountLedger* sharedLedger, CardDirectory* sharedDirectory)
+  : output(&cout), silent(nullptr) {
+  ledger = sharedLedger;
+  stateId = IDLE;
+  journal = nullptr;
+  requestKey = 0;
+  cardDirectory = sharedDirectory;
+  atmId = 0;
+  pinnedClock = -1;
+  currentCard = nullptr;
+  currentAccount = nullptr;
+  currentOperation = WITHDRAW;
+  consoleInput = true;
+  awaitingInput = false;
 };
 
-class SelectOperationState : public ATMState{
+/* ---------------- TABLE-DRIVEN TRANSITIONS ----------------
+ The ATM's states and events, declared as rows of the shared
+ compile-time state machine (StateMachine.h). An action's
+ StepResult picks the row's target: STEP_DONE goes to the
+ row's next state, STEP_WAIT stays, STEP_ABORT returns to
+ Idle.
+*/
+
+// State and event tags, listed in ATMStateId / ATMEventType order.
+struct AtIdle{};
+struct AtHasCard{};
+struct AtPinValidation{};
+struct AtSelectOperation{};
+struct AtTransaction{};
+
+struct OnCardInserted{};
+struct OnOperationSelected{};
+struct OnNumberEntered{};
+struct OnConfirmed{};
+struct OnCardRemoved{};
+
+// Actions.
+int insertCardAction(ATMMachine& atm, const ATMEvent& event){
+  atm.clearSession();   // drops numbers typed with no card in
+  atm.setCard(event.card);
+  atm.out()<<"Card Inserted Successfully!!"<<endl;
+  return STEP_DONE;
+}
+
+int alreadyInsertedAction(ATMMachine& atm, const ATMEvent&){
+  atm.out()<<"Card Already Inserted"<<endl;
+  return STEP_DONE;
+}
+
+int needCardAction(ATMMachine& atm, const ATMEvent&){
+  atm.out()<<"Insert Card First"<<endl;
+  return STEP_DONE;
+}
+
+int needOperationAction(ATMMachine& atm, const ATMEvent&){
+  atm.out()<<"Select Operation First"<<endl;
+  return STEP_DONE;
+}
+
+int startPinAction(ATMMachine& atm, const ATMEvent& event){
+  atm.setOperation(event.operation);
+  atm.out()<<"Proceeding to PIN Validation"<<endl;
+  return validatePinStep(&atm);
+}
+
+int validatePinAction(ATMMachine& atm, const ATMEvent& event){
+  atm.setOperation(event.operation);
+  return validatePinStep(&atm);
+}
+
+int enterPinAction(ATMMachine& atm, const ATMEvent& event){
+  atm.provideInput(event.value);
+  return validatePinStep(&atm);
+}
+
+int chooseOperationAction(ATMMachine& atm, const ATMEvent& event){
+  atm.setOperation(event.operation);
+  return STEP_DONE;
+}
+
+int busyAction(ATMMachine& atm, const ATMEvent&){
+  atm.out()<<"Operation Already Selected, Processing Transaction"<<endl;
+  return STEP_DONE;
+}
+
+int bufferNumberAction(ATMMachine& atm, const ATMEvent& event){
+  atm.provideInput(event.value);
+  return STEP_DONE;
+}
+
+int runTransactionAction(ATMMachine& atm, const ATMEvent& event){
+  atm.setRequestKey(event.requestKey);
+  return transactionStep(&atm);
+}
+
+// An amount typed before CONFIRMED is only buffered.
+int enterAmountAction(ATMMachine& atm, const ATMEvent& event){
+  bool resume = atm.isAwaitingInput();
+  atm.provideInput(event.value);
+  return resume ? transactionStep(&atm) : STEP_WAIT;
+}
+
+int ejectCardAction(ATMMachine& atm, const ATMEvent&){
+  atm.out()<<"Card Removed"<<endl;
+  atm.clearSession();
+  return STEP_DONE;
+}
+
+int cancelAction(ATMMachine& atm, const ATMEvent&){
+  atm.out()<<"Transaction Cancelled"<<endl;
+  atm.clearSession();
+  return STEP_DONE;
+}
+
+int abandonTransactionAction(ATMMachine& atm, const ATMEvent&){
+  atm.out()<<"Transaction Failed, Card Removed"<<endl;
+  atm.clearSession();
+  return STEP_DONE;
+}
+
+static_assert(STEP_DONE == 0 && STEP_WAIT == 1 && STEP_ABORT == 2,
+              "StepResult indexes the targets of an ATMRow");
+
+template<class From, class Event, auto Action, class Next>
+using ATMRow = fsm::Row<From, Event, Action, Next, From, AtIdle>;
+
+typedef fsm::StateMachine<ATMMachine, ATMEvent,
+  fsm::List<AtIdle, AtHasCard, AtPinValidation, AtSelectOperation, AtTransaction>,
+  fsm::List<OnCardInserted, OnOperationSelected, OnNumberEntered, OnConfirmed, OnCardRemoved>,
+
+  ATMRow<AtIdle, OnCardInserted,      insertCardAction,      AtHasCard>,
+  ATMRow<AtIdle, OnOperationSelected, needCardAction,        AtIdle>,
+  ATMRow<AtIdle, OnNumberEntered,     bufferNumberAction,    AtIdle>,
+  ATMRow<AtIdle, OnConfirmed,         needOperationAction,   AtIdle>,
+  ATMRow<AtIdle, OnCardRemoved,       needCardAction,        AtIdle>,
+
+  ATMRow<AtHasCard, OnCardInserted,      alreadyInsertedAction, AtHasCard>,
+  fsm::Row<AtHasCard, OnOperationSelected, startPinAction, AtSelectOperation, AtPinValidation, AtIdle>,
+  ATMRow<AtHasCard, OnNumberEntered,     bufferNumberAction,    AtHasCard>,
+  ATMRow<AtHasCard, OnConfirmed,         needOperationAction,   AtIdle>,
+  ATMRow<AtHasCard, OnCardRemoved,       ejectCardAction,       AtIdle>,
+
+  ATMRow<AtPinValidation, OnCardInserted,      alreadyInsertedAction, AtPinValidation>,
+  ATMRow<AtPinValidation, OnOperationSelected, validatePinAction,     AtSelectOperation>,
+  ATMRow<AtPinValidation, OnNumberEntered,     enterPinAction,        AtSelectOperation>,
+  ATMRow<AtPinValidation, OnConfirmed,         needOperationAction,   AtPinValidation>,
+  ATMRow<AtPinValidation, OnCardRemoved,       ejectCardAction,       AtIdle>,
+
+  ATMRow<AtSelectOperation, OnCardInserted,      alreadyInsertedAction, AtSelectOperation>,
+  ATMRow<AtSelectOperation, OnOperationSelected, chooseOperationAction, AtTransaction>,
+  ATMRow<AtSelectOperation, OnNumberEntered,     bufferNumberAction,    AtSelectOperation>,
+  ATMRow<AtSelectOperation, OnConfirmed,         needOperationAction,   AtSelectOperation>,
+  ATMRow<AtSelectOperation, OnCardRemoved,       cancelAction,          AtIdle>,
+
+  ATMRow<AtTransaction, OnCardInserted,      alreadyInsertedAction,    AtTransaction>,
+  ATMRow<AtTransaction, OnOperationSelected, busyAction,               AtTransaction>,
+  ATMRow<AtTransaction, OnNumberEntered,     enterAmountAction,        AtIdle>,
+  ATMRow<AtTransaction, OnConfirmed,         runTransactionAction,     AtIdle>,
+  ATMRow<AtTransaction, OnCardRemoved,       abandonTransactionAction, AtIdle>
+> ATMTable;
+
+// Compile-time checks on the table.
+static_assert(ATMTable::id<AtTransaction> == TRANSACTION
+              && ATMTable::eventId<OnCardRemoved> == CARD_REMOVED,
+              "tags must follow ATMStateId / ATMEventType");
+
+constexpr bool removingCardAlwaysEndsInIdle(){
+  for(int st = 0; st < ATM_STATE_COUNT; st++)
+    if(ATMTable::target(st, CARD_REMOVED) != IDLE)
+      return false;
+  return true;
+}
+
+constexpr bool transactionOnlyAfterSelection(){
+  for(int st = 0; st < ATM_STATE_COUNT; st++)
+    for(int ev = 0; ev < ATM_EVENT_COUNT; ev++)
+      if(ATMTable::target(st, ev) == TRANSACTION
+         && st != SELECT_OPERATION && st != TRANSACTION)
+        return false;
+  return true;
+}
+
+// Only PIN entry and a transaction consume numbers; every
+// other state just buffers them.
+constexpr bool numbersOnlyResumeInputSteps(){
+  for(int st = 0; st < ATM_STATE_COUNT; st++){
+    if(st == PIN_VALIDATION || st == TRANSACTION) continue;
+    if(ATMTable::target(st, NUMBER_ENTERED) != st
+       || ATMTable::action(st, NUMBER_ENTERED) != &bufferNumberAction)
+      return false;
+  }
+  return true;
+}
+
+static_assert(ATMTable::total(), "every (state, event) pair needs a row");
+static_assert(removingCardAlwaysEndsInIdle(), "CARD_REMOVED must return to Idle");
+static_assert(transactionOnlyAfterSelection(), "Transaction entered without an operation");
+static_assert(numbersOnlyResumeInputSteps(), "NUMBER_ENTERED changed state outside an input step");
+static_assert(ATMTable::reachableFrom(IDLE), "unreachable ATM state");
+
+void ATMMachine::processNextEvent(){
+  ATMEvent event;
+  if(!takeNextEvent(event)) return;
+
+  fsm::StateId state = stateId;
+  ATMTable::dispatch(*this, state, event.type, event);
+  setCurrentState((ATMStateId)state);
+}
+
+/* ---------------- VIRTUAL-DISPATCH REFERENCE ----------------
+ The ATM as it was before ATMTable: one object per state,
+ one virtual method per event. Kept only so CASE 12 can
+ measure both designs on the same sessions; it runs the same
+ actions and follows the same rows as ATMTable.
+*/
+
+// Where a row goes after its action returns a StepResult.
+ATMStateId followStep(int result, ATMStateId next, ATMStateId self){
+  return result == STEP_DONE ? next : result == STEP_WAIT ? self : IDLE;
+}
+
+class ReferenceATMState{
   public:
-    ATMState* insertCard(ATMMachine* state) override {
-      cout<<"Card Already Inserted"<<endl;
-      return this;
-    }
+    virtual ~ReferenceATMState() {}
+    virtual ATMStateId insertCard(ATMMachine& atm, const ATMEvent& event) = 0;
+    virtual ATMStateId selectOperation(ATMMachine& atm, const ATMEvent& event) = 0;
+    virtual ATMStateId enterNumber(ATMMachine& atm, const ATMEvent& event) = 0;
+    virtual ATMStateId confirm(ATMMachine& atm, const ATMEvent& event) = 0;
+    virtual ATMStateId removeCard(ATMMachine& atm, const ATMEvent& event) = 0;
+};
 
-    ATMState* removeCard(ATMMachine* state) override {
-      cout<<"Transaction Cancelled"<<endl;
-      state->clearSession();
-      return state->getIdleState();
-    }
+class ReferenceIdle : public ReferenceATMState{
+  public:
+    ATMStateId insertCard(ATMMachine& atm, const ATMEvent& e) override { return followStep(insertCardAction(atm, e), HAS_CARD, IDLE); }
+    ATMStateId selectOperation(ATMMachine& atm, const ATMEvent& e) override { return followStep(needCardAction(atm, e), IDLE, IDLE); }
+    ATMStateId enterNumber(ATMMachine& atm, const ATMEvent& e) override { return followStep(bufferNumberAction(atm, e), IDLE, IDLE); }
+    ATMStateId confirm(ATMMachine& atm, const ATMEvent& e) override { return followStep(needOperationAction(atm, e), IDLE, IDLE); }
+    ATMStateId removeCard(ATMMachine& atm, const ATMEvent& e) override { return followStep(needCardAction(atm, e), IDLE, IDLE); }
+};
 
-    ATMState* selectOperation(ATMMachine* state, OperationType &operation) override {
-      state->setOperation(operation);
-      return state->getTransactionState();
-    }
+class ReferenceHasCard : public ReferenceATMState{
+  public:
+    ATMStateId insertCard(ATMMachine& atm, const ATMEvent& e) override { return followStep(alreadyInsertedAction(atm, e), HAS_CARD, HAS_CARD); }
+    ATMStateId selectOperation(ATMMachine& atm, const ATMEvent& e) override { return followStep(startPinAction(atm, e), SELECT_OPERATION, PIN_VALIDATION); }
+    ATMStateId enterNumber(ATMMachine& atm, const ATMEvent& e) override { return followStep(bufferNumberAction(atm, e), HAS_CARD, HAS_CARD); }
+    ATMStateId confirm(ATMMachine& atm, const ATMEvent& e) override { return followStep(needOperationAction(atm, e), IDLE, HAS_CARD); }
+    ATMStateId removeCard(ATMMachine& atm, const ATMEvent& e) override { return followStep(ejectCardAction(atm, e), IDLE, HAS_CARD); }
+};
 
-    ATMState* transactionState(ATMMachine* state) override {
-      cout<<"Select Operation First"<<endl;
-      return this;
-    }
+class ReferencePinValidation : public ReferenceATMState{
+  public:
+    ATMStateId insertCard(ATMMachine& atm, const ATMEvent& e) override { return followStep(alreadyInsertedAction(atm, e), PIN_VALIDATION, PIN_VALIDATION); }
+    ATMStateId selectOperation(ATMMachine& atm, const ATMEvent& e) override { return followStep(validatePinAction(atm, e), SELECT_OPERATION, PIN_VALIDATION); }
+    ATMStateId enterNumber(ATMMachine& atm, const ATMEvent& e) override { return followStep(enterPinAction(atm, e), SELECT_OPERATION, PIN_VALIDATION); }
+    ATMStateId confirm(ATMMachine& atm, const ATMEvent& e) override { return followStep(needOperationAction(atm, e), PIN_VALIDATION, PIN_VALIDATION); }
+    ATMStateId removeCard(ATMMachine& atm, const ATMEvent& e) override { return followStep(ejectCardAction(atm, e), IDLE, PIN_VALIDATION); }
+};
 
-    string getStateName() override {
-      return "Select_Operation_State";
-    }
+class ReferenceSelectOperation : public ReferenceATMState{
+  public:
+    ATMStateId insertCard(ATMMachine& atm, const ATMEvent& e) override { return followStep(alreadyInsertedAction(atm, e), SELECT_OPERATION, SELECT_OPERATION); }
+    ATMStateId selectOperation(ATMMachine& atm, const ATMEvent& e) override { return followStep(chooseOperationAction(atm, e), TRANSACTION, SELECT_OPERATION); }
+    ATMStateId enterNumber(ATMMachine& atm, const ATMEvent& e) override { return followStep(bufferNumberAction(atm, e), SELECT_OPERATION, SELECT_OPERATION); }
+    ATMStateId confirm(ATMMachine& atm, const ATMEvent& e) override { return followStep(needOperationAction(atm, e), SELECT_OPERATION, SELECT_OPERATION); }
+    ATMStateId removeCard(ATMMachine& atm, const ATMEvent& e) override { return followStep(cancelAction(atm, e), IDLE, SELECT_OPERATION); }
 };
 
-class TransactionState : public ATMState{
+class ReferenceTransaction : public ReferenceATMState{
   public:
-    ATMState* insertCard(ATMMachine* state) override {
-      cout<<"Card Already Inserted!!"<<endl;
-      return this;
+    ATMStateId insertCard(ATMMachine& atm, const ATMEvent& e) override { return followStep(alreadyInsertedAction(atm, e), TRANSACTION, TRANSACTION); }
+    ATMStateId selectOperation(ATMMachine& atm, const ATMEvent& e) override { return followStep(busyAction(atm, e), TRANSACTION, TRANSACTION); }
+    ATMStateId enterNumber(ATMMachine& atm, const ATMEvent& e) override { return followStep(enterAmountAction(atm, e), IDLE, TRANSACTION); }
+    ATMStateId confirm(ATMMachine& atm, const ATMEvent& e) override { return followStep(runTransactionAction(atm, e), IDLE, TRANSACTION); }
+    ATMStateId removeCard(ATMMachine& atm, const ATMEvent& e) override { return followStep(abandonTransactionAction(atm, e), IDLE, TRANSACTION); }
+};
+
+// processNextEvent() through the reference states.
+void processNextEventVirtual(ATMMachine& atm){
+  static ReferenceIdle idle;
+  static ReferenceHasCard hasCard;
+  static ReferencePinValidation pinValidation;
+  static ReferenceSelectOperation selectOperation;
+  static ReferenceTransaction transaction;
+  static ReferenceATMState* const states[ATM_STATE_COUNT] =
+    {&idle, &hasCard, &pinValidation, &selectOperation, &transaction};
+
+  ATMEvent event;
+  if(!atm.takeNextEvent(event)) return;
+  ReferenceATMState* state = states[atm.getStateId()];
+  ATMStateId next = IDLE;
+  switch(event.type){
+    case CARD_INSERTED:      next = state->insertCard(atm, event); break;
+    case OPERATION_SELECTED: next = state->selectOperation(atm, event); break;
+    case NUMBER_ENTERED:     next = state->enterNumber(atm, event); break;
+    case CONFIRMED:          next = state->confirm(atm, event); break;
+    case CARD_REMOVED:       next = state->removeCard(atm, event); break;
+  }
+  atm.setCurrentState(next);
+}
+
+void processNextEventTable(ATMMachine& atm){
+  atm.processNextEvent();
+}
+
+// Runs many ATM sessions on one thread. A machine sits in the
+// ready queue exactly while it has unprocessed events, and
+// gets one event per turn so sessions interleave fairly.
+class ATMEventLoop{
+  private:
+    deque<ATMMachine*> ready;
+    void (*process)(ATMMachine&);
+
+  public:
+    // `step` applies one event; processNextEventVirtual runs
+    // the virtual-dispatch reference instead of ATMTable.
+    ATMEventLoop(void (*step)(ATMMachine&) = processNextEventTable) : process(step) {}
+
+    void post(ATMMachine* atm, const ATMEvent& event){
+      if(!atm->hasPendingEvents())
+        ready.push_back(atm);
+      atm->postEvent(event);
     }
 
-    ATMState* removeCard(ATMMachine* state) override {
-      cout<<"Transaction Failed, Card Removed"<<endl;
-      return this;
+    // Drains every queue; returns the number of events handled.
+    long long run(){
+      long long handled = 0;
+      while(!ready.empty()){
+        ATMMachine* atm = ready.front();
+        ready.pop_front();
+        process(*atm);
+        handled++;
+        if(atm->hasPendingEvents())
+          ready.push_back(atm);
+      }
+      return handled;
     }
+};
+
+struct ReplayReport{
+  long long sessions = 0;
+  long long events = 0;
+  double seconds = 0;
+  bool allIdle = false;
+  long long debited = 0;     // Rs taken from accounts
+  long long dispensed = 0;   // Rs paid out by the fleet
+};
 
-    ATMState* selectOperation(ATMMachine* state, OperationType &operation) override {
-      cout<<"Operation Already Selected, Processing Transaction"<<endl;
-      return this;
+// Posts one scripted customer session: withdrawal (kind 0),
+// balance inquiry (1), wrong PIN (2) or cancel (3).
+void postScriptedSession(ATMEventLoop& loop, ATMMachine* atm, Card* card, int pin,
+                         int kind, int amount){
+  ATMEvent insert{CARD_INSERTED};
+  insert.card = card;
+  ATMEvent select{OPERATION_SELECTED};
+  select.operation = (kind == 1) ? BALANCE_INQUIRY : WITHDRAW;
+  ATMEvent number{NUMBER_ENTERED};
+
+  loop.post(atm, insert);
+  if(kind != 3){
+    loop.post(atm, select);
+    number.value = (kind == 2) ? pin + 1 : pin;
+    loop.post(atm, number);
+    if(kind != 2){
+      loop.post(atm, select);
+      if(kind == 0){
+        number.value = amount;
+        loop.post(atm, number);
+      }
+      loop.post(atm, ATMEvent{CONFIRMED});
     }
+  }
+  loop.post(atm, ATMEvent{CARD_REMOVED});
+}
+
+// Replays a fixed, seeded session mix over a fresh fleet and
+// ledger on one thread, with the ATMs' output muted.
+ReplayReport replayScriptedSessions(int atmCount, int sessionsPerAtm,
+                                    void (*step)(ATMMachine&) = processNextEventTable){
+  AccountLedger ledger;
+  CardDirectory directory;
+  const int accountCount = 1000;
+  const Money opening = Money::rupees(100000);
+  vector<Account*> ledgerAccounts;
+  vector<Card*> cards;
+  for(int i = 0; i < accountCount; i++){
+    ledgerAccounts.push_back(new Account("EVT" + to_string(i), opening));
+    ledger.addAccount(ledgerAccounts.back());
+    cards.push_back(new Card("EVTCARD" + to_string(i), "EVT" + to_string(i)));
+    directory.enroll(cards.back()->getCardNumber(), 1000 + i, ledgerAccounts.back());
+  }
+
+  vector<ATMMachine*> fleet;
+  for(int i = 0; i < atmCount; i++){
+    fleet.push_back(new ATMMachine(&ledger, &directory));
+    fleet.back()->setConsoleInput(false);
+    fleet.back()->setOutput(nullptr);
+  }
+
+  ATMEventLoop loop(step);
+  mt19937 rng(11);
+  ReplayReport report;
+  for(int s = 0; s < sessionsPerAtm; s++){
+    for(int a = 0; a < atmCount; a++){
+      int idx = rng() % accountCount;
+      int kind = rng() % 10;
+      kind = (kind < 6) ? 0 : (kind < 8) ? 1 : (kind < 9) ? 2 : 3;
+      postScriptedSession(loop, fleet[a], cards[idx], 1000 + idx, kind, 10 * (1 + rng() % 50));
+      report.sessions++;
+    }
+  }
+
+  auto start = chrono::steady_clock::now();
+  report.events = loop.run();
+  report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  int idle = 0;
+  for(ATMMachine* atm : fleet)
+    if(atm->getStateId() == IDLE) idle++;
+  report.allIdle = (idle == atmCount);
+
+  Money loaded = ATMInventory().getTotalCash();
+  for(Account* account : ledgerAccounts)
+    report.debited += (opening - account->getBalance()).wholeRupees();
+  for(ATMMachine* atm : fleet)
+    report.dispensed += (loaded - atm->getInventory().getTotalCash()).wholeRupees();
+  return report;
+}
+
+/* ---------------- FLEET SIMULATOR ----------------
+ Headless benchmark harness: N ATMMachines over one shared
+ ledger, driven by a seeded mix of scripted sessions (see
+ postScriptedSession). Each session is run to completion on
+ its ATM and timed, so latencies are service times. The
+ report is emitted as JSON.
+*/
 
-    ATMState* transactionState(ATMMachine* state) override {
-      OperationType type = state->getCurrentOperation();
+enum AmountDistribution{
+  UNIFORM_AMOUNTS,     // any multiple of 10 in [minAmount, maxAmount]
+  ROUND_HUNDREDS,      // multiples of 100 only, like most real requests
+  HEAVY_TAIL           // log-normal: many small, a few large
+};
 
-      if (type == OperationType::WITHDRAW) {
-        int amount = 0;
-        cout << "Enter Amount To Withdraw : ";
-        cin >> amount;
+struct FleetConfig{
+  int atmCount = 200;
+  int accountCount = 5000;
+  Money openingBalance = Money::rupees(50000);   // per account
+  Money dailyLimit = Money::rupees(10000);       // per account, 0 = none
+  int sessions = 200000;
+  // Every denomination, every ATM. Sized so the default mix
+  // leaves the fleet with cash: the run measures withdrawals
+  // that pay out, not the cash-short path.
+  int notesPerCassette = 10000;
+  // Session mix; the shares need not add up to one.
+  double withdrawShare = 0.6;
+  double balanceShare = 0.2;
+  double wrongPinShare = 0.1;
+  double cancelShare = 0.1;
+  AmountDistribution amounts = ROUND_HUNDREDS;
+  int minAmount = 100;
+  int maxAmount = 2000;
+  int depletionSamples = 10;
+  unsigned seed = 41;
+  // Simulated clock: every ATM is pinned to it, and it moves
+  // on by secondsPerSession after each session, so daily
+  // limits and dispense telemetry follow simulated time.
+  int64_t startTime = 20000 * Account::SECONDS_PER_DAY + 9 * 3600;
+  int secondsPerSession = 2;
+};
 
-        Account* account = state->getCurrentAccount();
+struct FleetReport{
+  FleetConfig config;
+  long long sessions = 0;
+  double seconds = 0;
+  double latencyMicros[4] = {};     // p50, p95, p99, max
+  ATMCounters totals;
+  long long withdrawalAttempts = 0;
+  struct DepletionPoint{
+    long long session;
+    long long fleetCash;
+    int atmsBelowMinimum;           // cannot pay minAmount any more
+  };
+  vector<DepletionPoint> depletion;
+
+  string toJson() const {
+    static const char* distributionNames[] = {"uniform", "round_hundreds", "heavy_tail"};
+    auto rate = [this](long long count){
+      return withdrawalAttempts ? (double)count / withdrawalAttempts : 0.0;
+    };
+    ostringstream out;
+    out << "{\n"
+        << "  \"atms\": " << config.atmCount << ", \"accounts\": " << config.accountCount
+        << ", \"sessions\": " << sessions
+        << ", \"simulated_hours\": " << sessions * config.secondsPerSession / 3600.0
+        << ", \"notes_per_cassette\": " << config.notesPerCassette
+        << ", \"amounts\": \"" << distributionNames[config.amounts] << "\",\n"
+        << "  \"sessions_per_second\": " << (long long)(sessions / seconds) << ",\n"
+        << "  \"latency_us\": {\"p50\": " << latencyMicros[0] << ", \"p95\": " << latencyMicros[1]
+        << ", \"p99\": " << latencyMicros[2] << ", \"max\": " << latencyMicros[3] << "},\n"
+        << "  \"withdrawals\": {\"attempted\": " << withdrawalAttempts
+        << ", \"paid\": " << totals.withdrawals
+        << ", \"dispensed_rs\": " << totals.amountDispensed << "},\n"
+        << "  \"failure_rates\": {\"cash_short\": " << rate(totals.cashShort)
+        << ", \"exact_amount\": " << rate(totals.exactAmountFailed)
+        << ", \"balance_short\": " << rate(totals.balanceShort)
+        << ", \"daily_limit\": " << rate(totals.dailyLimitHit) << "},\n"
+        << "  \"wrong_pins\": " << totals.wrongPins
+        << ", \"balance_inquiries\": " << totals.balanceInquiries << ",\n"
+        << "  \"cash_depletion\": [";
+    for(size_t i = 0; i < depletion.size(); i++){
+      out << (i ? ",\n    " : "\n    ")
+          << "{\"session\": " << depletion[i].session << ", \"fleet_cash_rs\": "
+          << depletion[i].fleetCash << ", \"atms_below_min\": " << depletion[i].atmsBelowMinimum << "}";
+    }
+    out << "\n  ]\n}";
+    return out.str();
+  }
+};
 
-        if (account->getBalance() < amount) {
-            cout << "Insufficient Balance in Your Account" << endl;
-            return this;
+class ATMFleetSimulator{
+  private:
+    static int drawAmount(const FleetConfig& config, mt19937& rng){
+      int amount;
+      switch(config.amounts){
+        case ROUND_HUNDREDS: {
+          int steps = max(1, config.maxAmount / 100 - config.minAmount / 100 + 1);
+          amount = (config.minAmount / 100 + (int)(rng() % steps)) * 100;
+          break;
         }
-
-        if (!state->getInventory().hasSufficientCash(amount)) {
-            cout << "Not Sufficient Cash in Inventory" << endl;
-            return this;
+        case HEAVY_TAIL: {
+          // Median at the geometric mean of the range.
+          double median = sqrt((double)max(config.minAmount, 1) * config.maxAmount);
+          lognormal_distribution<double> dist(log(median), 0.8);
+          amount = (int)(dist(rng) / 10) * 10;
+          break;
         }
-
-        account->withdraw(amount);
-
-        auto cash = state->getInventory().dispenseCash(amount);
-        if (cash.empty()) {
-            cout << "Cannot Dispense Exact Amount" << endl;
-            account->deposit(amount);   // rollback
-            return this;
+        default: {
+          int steps = max(1, (config.maxAmount - config.minAmount) / 10 + 1);
+          amount = config.minAmount + 10 * (int)(rng() % steps);
         }
-
-        cout << "Cash Dispensed Successfully" << endl;
       }
-      else if (type == OperationType::BALANCE_INQUIRY) {
-          cout << "Current Balance : "
-              << state->getCurrentAccount()->getBalance()
-              << endl;
-      }
-
-      state->clearSession();
-      return state->getIdleState();
+      return min(max(amount, config.minAmount), config.maxAmount);
     }
 
-    string getStateName() override {
-      return "Transaction_State";
+    static void sampleDepletion(FleetReport& report, vector<ATMMachine*>& fleet,
+                                long long session){
+      FleetReport::DepletionPoint point{session, 0, 0};
+      for(ATMMachine* atm : fleet){
+        Money cash = atm->getInventory().getTotalCash();
+        point.fleetCash += cash.wholeRupees();
+        if(cash < Money::rupees(report.config.minAmount)) point.atmsBelowMinimum++;
+      }
+      report.depletion.push_back(point);
     }
-};
 
-ATMMachine::ATMMachine(){
-  idleState = new IdleState();
-  hasCardState = new HasCardState();
-  pinValidationState = new PinValidationState();
-  selectOperationState = new SelectOperationState();
-  transactionState = new TransactionState();
+  public:
+    static FleetReport run(const FleetConfig& config){
+      FleetReport report;
+      report.config = config;
+
+      AccountLedger ledger;
+      CardDirectory directory;
+      vector<Account*> accounts;
+      vector<Card*> cards;
+      for(int i = 0; i < config.accountCount; i++){
+        string accountNumber = "FLT" + to_string(i);
+        accounts.push_back(new Account(accountNumber, config.openingBalance));
+        accounts.back()->setDailyLimit(config.dailyLimit);
+        ledger.addAccount(accounts.back());
+        cards.push_back(new Card("FLTCARD" + to_string(i), accountNumber));
+        directory.enroll(cards.back()->getCardNumber(), 1000 + i % 9000, accounts.back());
+      }
+      vector<ATMMachine*> fleet;
+      for(int i = 0; i < config.atmCount; i++){
+        fleet.push_back(new ATMMachine(&ledger, &directory));
+        fleet.back()->setConsoleInput(false);
+        fleet.back()->setOutput(nullptr);
+        for(CashType type : DENOMINATIONS)
+          fleet.back()->getInventory().loadCassette(type, config.notesPerCassette);
+      }
 
-  currentState = idleState;
-  currentCard = nullptr;
-  currentAccount = nullptr;
+      double shareTotal = config.withdrawShare + config.balanceShare
+                        + config.wrongPinShare + config.cancelShare;
+      mt19937 rng(config.seed);
+      uniform_real_distribution<double> pick(0.0, shareTotal);
+      vector<float> latencies;
+      latencies.reserve(config.sessions);
+      long long sampleEvery = max(1, config.sessions / max(1, config.depletionSamples));
+
+      ATMEventLoop loop;
+      sampleDepletion(report, fleet, 0);
+      auto started = chrono::steady_clock::now();
+      for(int s = 0; s < config.sessions; s++){
+        int idx = rng() % config.accountCount;
+        double p = pick(rng);
+        int kind = (p < config.withdrawShare) ? 0
+                 : (p < config.withdrawShare + config.balanceShare) ? 1
+                 : (p < shareTotal - config.cancelShare) ? 2 : 3;
+        if(kind == 0) report.withdrawalAttempts++;
+        ATMMachine* atm = fleet[s % config.atmCount];
+        atm->pinClock(config.startTime + (int64_t)s * config.secondsPerSession);
+
+        auto begin = chrono::steady_clock::now();
+        postScriptedSession(loop, atm, cards[idx], 1000 + idx % 9000, kind, drawAmount(config, rng));
+        loop.run();
+        latencies.push_back(chrono::duration<float, micro>(chrono::steady_clock::now() - begin).count());
+
+        if((s + 1) % sampleEvery == 0)
+          sampleDepletion(report, fleet, s + 1);
+      }
+      report.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+      report.sessions = config.sessions;
+
+      if(!latencies.empty()){
+        const double ranks[3] = {0.50, 0.95, 0.99};
+        for(int r = 0; r < 3; r++){
+          size_t k = (size_t)(ranks[r] * (latencies.size() - 1));
+          nth_element(latencies.begin(), latencies.begin() + k, latencies.end());
+          report.latencyMicros[r] = latencies[k];
+        }
+        report.latencyMicros[3] = *max_element(latencies.begin(), latencies.end());
+      }
+
+      for(ATMMachine* atm : fleet){
+        ATMCounters& c = atm->getCounters();
+        report.totals.withdrawals += c.withdrawals;
+        report.totals.amountDispensed += c.amountDispensed;
+        report.totals.cashShort += c.cashShort;
+        report.totals.balanceShort += c.balanceShort;
+        report.totals.exactAmountFailed += c.exactAmountFailed;
+        report.totals.balanceInquiries += c.balanceInquiries;
+        report.totals.wrongPins += c.wrongPins;
+        report.totals.dailyLimitHit += c.dailyLimitHit;
+        delete atm;
+      }
+      for(Account* account : accounts) delete account;
+      for(Card* card : cards) delete card;
+      return report;
+    }
 };
 
 int main() {
@@ -508,11 +2330,11 @@ int main() {
     ATMMachine atm;
 
     // Accounts
-    Account acc1("ACC001", 5000);   // normal
-    Account acc2("ACC002", 100);    // low balance
-    Account acc3("ACC003", 0);      // zero balance
-    Account acc4("ACC004", 10000);  // high balance
-    Account acc5("ACC005", 50);     // edge case
+    Account acc1("ACC001", Money::rupees(5000));   // normal
+    Account acc2("ACC002", Money::rupees(100));    // low balance
+    Account acc3("ACC003", Money::rupees(0));      // zero balance
+    Account acc4("ACC004", Money::rupees(10000));  // high balance
+    Account acc5("ACC005", Money::rupees(50));     // edge case
 
     atm.addAccount(&acc1);
     atm.addAccount(&acc2);
@@ -521,72 +2343,821 @@ int main() {
     atm.addAccount(&acc5);
 
     // Cards
-    Card card1("CARD001", 1111, "ACC001");
-    Card card2("CARD002", 2222, "ACC002");
-    Card card3("CARD003", 3333, "ACC003");
-    Card card4("CARD004", 4444, "ACC004");
-    Card card5("CARD005", 5555, "ACC005");
+    Card card1("CARD001", "ACC001");
+    Card card2("CARD002", "ACC002");
+    Card card3("CARD003", "ACC003");
+    Card card4("CARD004", "ACC004");
+    Card card5("CARD005", "ACC005");
+
+    atm.enrollCard(&card1, 1111);
+    atm.enrollCard(&card2, 2222);
+    atm.enrollCard(&card3, 3333);
+    atm.enrollCard(&card4, 4444);
+    atm.enrollCard(&card5, 5555);
 
     OperationType withdraw = WITHDRAW;
     OperationType balance  = BALANCE_INQUIRY;
 
+    // Cases 1-7 post one event at a time and run it; PINs and
+    // amounts are typed on std::cin when prompted.
+    auto press = [&atm](ATMEventType type, OperationType operation = WITHDRAW, Card* card = nullptr){
+      ATMEvent event{type};
+      event.operation = operation;
+      event.card = card;
+      atm.postEvent(event);
+      atm.processNextEvent();
+    };
+    auto ejectIfBusy = [&](){
+      if(atm.getStateId() != IDLE)
+        press(CARD_REMOVED);
+    };
+
     // =====================================================
     cout << "\n--- CASE 1: Successful Withdrawal ---\n";
-    atm.setCurrentState(atm.getIdleState());
-    atm.setCard(&card1);
-
-    atm.setCurrentState(atm.getCurrentState()->insertCard(&atm));
-    atm.setCurrentState(atm.getCurrentState()->selectOperation(&atm, withdraw));
-    atm.setCurrentState(atm.getCurrentState()->selectOperation(&atm, withdraw));
-    atm.setCurrentState(atm.getCurrentState()->transactionState(&atm));
+    press(CARD_INSERTED, withdraw, &card1);
+    press(OPERATION_SELECTED, withdraw);
+    press(OPERATION_SELECTED, withdraw);
+    press(CONFIRMED);
+    ejectIfBusy();
 
 
     // =====================================================
     cout << "\n--- CASE 2: Wrong PIN ---\n";
-    atm.setCurrentState(atm.getIdleState());
-    atm.setCard(&card1);
-
-    atm.setCurrentState(atm.getCurrentState()->insertCard(&atm));
-    atm.setCurrentState(atm.getCurrentState()->selectOperation(&atm, withdraw));
+    press(CARD_INSERTED, withdraw, &card1);
+    press(OPERATION_SELECTED, withdraw);
     // Enter WRONG PIN here when prompted
+    ejectIfBusy();
 
     // =====================================================
     cout << "\n--- CASE 3: Insufficient Balance ---\n";
-    atm.setCard(&card2);
-    atm.setCurrentState(atm.getCurrentState()->insertCard(&atm));
-    atm.setCurrentState(atm.getCurrentState()->selectOperation(&atm, withdraw));
-    atm.setCurrentState(atm.getCurrentState()->selectOperation(&atm, withdraw));
-    atm.setCurrentState(atm.getCurrentState()->transactionState(&atm));
+    press(CARD_INSERTED, withdraw, &card2);
+    press(OPERATION_SELECTED, withdraw);
+    press(OPERATION_SELECTED, withdraw);
+    press(CONFIRMED);
+    ejectIfBusy();
 
     // =====================================================
     cout << "\n--- CASE 4: Zero Balance Account ---\n";
-    atm.setCard(&card3);
-    atm.setCurrentState(atm.getCurrentState()->insertCard(&atm));
-    atm.setCurrentState(atm.getCurrentState()->selectOperation(&atm, withdraw));
-    atm.setCurrentState(atm.getCurrentState()->selectOperation(&atm, withdraw));
-    atm.setCurrentState(atm.getCurrentState()->transactionState(&atm));
+    press(CARD_INSERTED, withdraw, &card3);
+    press(OPERATION_SELECTED, withdraw);
+    press(OPERATION_SELECTED, withdraw);
+    press(CONFIRMED);
+    ejectIfBusy();
 
     // =====================================================
     cout << "\n--- CASE 5: Balance Inquiry (High Balance Account) ---\n";
-    atm.setCard(&card4);
-    atm.setCurrentState(atm.getCurrentState()->insertCard(&atm));
-    atm.setCurrentState(atm.getCurrentState()->selectOperation(&atm, balance));
-    atm.setCurrentState(atm.getCurrentState()->selectOperation(&atm, balance));
-    atm.setCurrentState(atm.getCurrentState()->transactionState(&atm));
+    press(CARD_INSERTED, balance, &card4);
+    press(OPERATION_SELECTED, balance);
+    press(OPERATION_SELECTED, balance);
+    press(CONFIRMED);
+    ejectIfBusy();
 
     // =====================================================
     cout << "\n--- CASE 6: Edge Case Small Balance ---\n";
-    atm.setCard(&card5);
-    atm.setCurrentState(atm.getCurrentState()->insertCard(&atm));
-    atm.setCurrentState(atm.getCurrentState()->selectOperation(&atm, withdraw));
-    atm.setCurrentState(atm.getCurrentState()->selectOperation(&atm, withdraw));
-    atm.setCurrentState(atm.getCurrentState()->transactionState(&atm));
+    press(CARD_INSERTED, withdraw, &card5);
+    press(OPERATION_SELECTED, withdraw);
+    press(OPERATION_SELECTED, withdraw);
+    press(CONFIRMED);
+    ejectIfBusy();
 
     // =====================================================
     cout << "\n--- CASE 7: User Cancels Transaction ---\n";
-    atm.setCard(&card4);
-    atm.setCurrentState(atm.getCurrentState()->insertCard(&atm));
-    atm.setCurrentState(atm.getCurrentState()->removeCard(&atm));
+    press(CARD_INSERTED, withdraw, &card4);
+    press(CARD_REMOVED);
+
+    // =====================================================
+    cout << "\n--- CASE 8: Many ATMs Sharing One Ledger (Stress) ---\n";
+    {
+      // One thread per ATM, each running whole customer sessions
+      // (card, PIN, operation, amount) on its own event loop,
+      // all against the same accounts.
+      AccountLedger ledger;
+      CardDirectory directory;
+      const int accountCount = 100;
+      const Money opening = Money::rupees(1000000);
+      vector<Account*> ledgerAccounts;
+      vector<Card*> cards;
+      for(int i = 0; i < accountCount; i++){
+        ledgerAccounts.push_back(new Account("SHR" + to_string(i), opening));
+        ledger.addAccount(ledgerAccounts.back());
+        cards.push_back(new Card("SHRCARD" + to_string(i), "SHR" + to_string(i)));
+        directory.enroll(cards.back()->getCardNumber(), 1000 + i, ledgerAccounts.back());
+      }
+
+      const int atmCount = 8;
+      const int sessionsPerAtm = 5000;
+      vector<ATMMachine*> fleet;
+      for(int i = 0; i < atmCount; i++){
+        fleet.push_back(new ATMMachine(&ledger, &directory));
+        fleet.back()->setConsoleInput(false);
+        fleet.back()->setOutput(nullptr);
+        fleet.back()->setAtmId(i + 1);
+        for(CashType type : DENOMINATIONS)
+          fleet.back()->getInventory().loadCassette(type, 200000);
+      }
+
+      auto start = chrono::steady_clock::now();
+      vector<thread> workers;
+      for(int a = 0; a < atmCount; a++){
+        workers.emplace_back([&, a](){
+          ATMEventLoop loop;
+          mt19937 rng(a + 1);
+          for(int s = 0; s < sessionsPerAtm; s++){
+            int idx = rng() % accountCount;
+            postScriptedSession(loop, fleet[a], cards[idx], 1000 + idx, 0, (1 + rng() % 50) * 100);
+            loop.run();
+          }
+        });
+      }
+      for(auto& w : workers) w.join();
+      double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+      // Every rupee that left an account is on its statement
+      // and was paid out by some ATM.
+      bool consistent = true;
+      long long debited = 0, dispensed = 0, approved = 0, declined = 0;
+      for(Account* account : ledgerAccounts){
+        Money taken = opening - account->getBalance();
+        if(account->getBalance() < Money() || taken != account->getHistory().withdrawnBetween(0, INT64_MAX))
+          consistent = false;
+        debited += taken.wholeRupees();
+      }
+      for(ATMMachine* atm : fleet){
+        dispensed += atm->getCounters().amountDispensed;
+        approved += atm->getCounters().withdrawals;
+        declined += atm->getCounters().balanceShort;
+        if(atm->getStateId() != IDLE) consistent = false;
+      }
+      consistent &= (debited == dispensed);
+
+      cout << atmCount * sessionsPerAtm << " sessions on " << atmCount << " ATMs | "
+           << approved << " approved, " << declined << " declined | "
+           << (long long)(atmCount * sessionsPerAtm / seconds) << " sessions/s" << endl;
+      cout << "No account negative, statements match balances, debited Rs " << debited
+           << " = dispensed Rs " << dispensed << ": " << (consistent ? "YES" : "NO") << endl;
+
+      for(ATMMachine* atm : fleet) delete atm;
+      for(Card* card : cards) delete card;
+      for(Account* account : ledgerAccounts) delete account;
+    }
+
+    // =====================================================
+    cout << "\n--- CASE 9: Optimal vs Greedy Cash Dispensing ---\n";
+    {
+      ATMInventory depleted;
+      depleted.loadCassette(BILL_10, 0);
+      depleted.loadCassette(BILL_5, 0);
+      depleted.loadCassette(BILL_1, 0);
+      cout << "Rs 60 with no 10/5/1 notes | greedy: "
+           << (depleted.planDispenseGreedy(60).empty() ? "FAILS" : "ok")
+           << " | optimal: "
+           << (depleted.planDispense(60).empty() ? "FAILS" : "ok ("
+               + to_string(depleted.planDispense(60).notes[denominationIndex(BILL_20)])
+               + " x Rs 20)") << endl;
+
+      ATMInventory uneven;
+      int unevenNotes[DENOMINATION_COUNT] = {0, 1, 3, 0, 1, 5};
+      for(int i = 0; i < DENOMINATION_COUNT; i++)
+        uneven.loadCassette(DENOMINATIONS[i], unevenNotes[i]);
+      cout << "Rs 60 from 1x50, 3x20, 1x5, 5x1 | greedy: "
+           << uneven.planDispenseGreedy(60).noteCount() << " notes | optimal: "
+           << uneven.planDispense(60).noteCount() << " notes" << endl;
+
+      // Random, partly depleted cassettes and random amounts.
+      mt19937 rng(99);
+      const int trials = 20000;
+      vector<ATMInventory> inventories(trials);
+      vector<int> amounts(trials);
+      for(int t = 0; t < trials; t++){
+        for(CashType type : DENOMINATIONS)
+          inventories[t].loadCassette(type, rng() % 6);
+        amounts[t] = 1 + rng() % 250;
+      }
+
+      int greedyOk = 0, optimalOk = 0, greedyNotes = 0, optimalNotes = 0, bothOk = 0;
+      auto g0 = chrono::steady_clock::now();
+      vector<CashBundle> greedyPlans(trials);
+      for(int t = 0; t < trials; t++)
+        greedyPlans[t] = inventories[t].planDispenseGreedy(amounts[t]);
+      auto g1 = chrono::steady_clock::now();
+      vector<CashBundle> optimalPlans(trials);
+      for(int t = 0; t < trials; t++)
+        optimalPlans[t] = inventories[t].planDispense(amounts[t]);
+      auto g2 = chrono::steady_clock::now();
+
+      for(int t = 0; t < trials; t++){
+        greedyOk += !greedyPlans[t].empty();
+        optimalOk += !optimalPlans[t].empty();
+        if(!greedyPlans[t].empty() && !optimalPlans[t].empty()){
+          bothOk++;
+          greedyNotes += greedyPlans[t].noteCount();
+          optimalNotes += optimalPlans[t].noteCount();
+        }
+      }
+
+      cout << trials << " requests on random cassettes" << endl;
+      cout << "  greedy : " << 100.0 * greedyOk / trials << "% success, "
+           << chrono::duration<double, nano>(g1 - g0).count() / trials << " ns/call" << endl;
+      cout << "  optimal: " << 100.0 * optimalOk / trials << "% success, "
+           << chrono::duration<double, nano>(g2 - g1).count() / trials << " ns/call" << endl;
+      cout << "  notes where both succeed: greedy " << greedyNotes
+           << ", optimal " << optimalNotes << " (" << bothOk << " requests)" << endl;
+
+      // Well-stocked cassettes: planDispense() stays on the
+      // greedy path, the DP only runs for BALANCE_WEAR.
+      ATMInventory stocked;
+      for(CashType type : DENOMINATIONS)
+        stocked.loadCassette(type, 1000);
+      const int largeTrials = 2000;   // the DP is ~0.2 ms at these amounts
+      vector<int> large(largeTrials);
+      for(int& amount : large) amount = 100 * (1 + rng() % 50) + rng() % 100;
+      long long fewest = 0, balanced = 0;
+      auto s0 = chrono::steady_clock::now();
+      for(int amount : large) fewest += stocked.planDispense(amount).noteCount();
+      auto s1 = chrono::steady_clock::now();
+      for(int amount : large) balanced += stocked.planDispense(amount, BALANCE_WEAR).noteCount();
+      auto s2 = chrono::steady_clock::now();
+      cout << "  full cassettes, Rs 100-5099: fewest notes "
+           << chrono::duration<double, nano>(s1 - s0).count() / largeTrials << " ns/call, balance wear (DP) "
+           << chrono::duration<double, nano>(s2 - s1).count() / largeTrials << " ns/call | notes "
+           << fewest << " vs " << balanced << endl;
+    }
+
+    // =====================================================
+    cout << "\n--- CASE 10: Cached Cash Total Under Concurrent Refill ---\n";
+    {
+      ATMInventory shared;
+      const int checks = 10000000;
+
+      auto c0 = chrono::steady_clock::now();
+      long long scanHits = 0;
+      for(int i = 0; i < checks; i++)
+        scanHits += shared.countTotalCash() >= Money::rupees(i & 2047);
+      auto c1 = chrono::steady_clock::now();
+      long long cachedHits = 0;
+      for(int i = 0; i < checks; i++)
+        cachedHits += shared.hasSufficientCash(Money::rupees(i & 2047));
+      auto c2 = chrono::steady_clock::now();
+
+      cout << "Balance check | full recount: "
+           << chrono::duration<double, nano>(c1 - c0).count() / checks << " ns"
+           << " | cached total: "
+           << chrono::duration<double, nano>(c2 - c1).count() / checks << " ns"
+           << " | same answers: " << (scanHits == cachedHits ? "YES" : "NO") << endl;
+
+      // Two customers withdrawing while the operator refills.
+      atomic<int> dispensed(0);
+      vector<thread> actors;
+      for(int c = 0; c < 2; c++)
+        actors.emplace_back([&](){
+          for(int i = 0; i < 20000; i++)
+            if(!shared.dispenseCash(Money::rupees(35 + i % 60)).empty())
+              dispensed++;
+        });
+      actors.emplace_back([&](){
+        for(int i = 0; i < 2000; i++)
+          shared.refill(DENOMINATIONS[i % DENOMINATION_COUNT], 5);
+      });
+      for(auto& actor : actors) actor.join();
+
+      cout << dispensed << " withdrawals served during refills | cached total Rs "
+           << shared.getTotalCash() << " | recount Rs " << shared.countTotalCash()
+           << " | consistent: "
+           << (shared.getTotalCash() == shared.countTotalCash() ? "YES" : "NO") << endl;
+    }
+
+    // =====================================================
+    cout << "\n--- CASE 11: Event Loop Replaying Scripted Sessions ---\n";
+    {
+      ReplayReport report = replayScriptedSessions(2000, 20);
+      cout << report.sessions << " scripted sessions on 2000 ATMs, one thread | "
+           << report.events << " events | " << (long long)(report.events / report.seconds)
+           << " events/s | " << (long long)(report.sessions / report.seconds)
+           << " sessions/s" << endl;
+      cout << "Every ATM back in Idle state: " << (report.allIdle ? "YES" : "NO")
+           << " | debited Rs " << report.debited << ", dispensed Rs " << report.dispensed << endl;
+    }
+
+    // =====================================================
+    cout << "\n--- CASE 12: Transition Table vs Virtual Dispatch ---\n";
+    {
+      // Same seeded sessions through the virtual-call states the
+      // table replaced, then through the table.
+      ReplayReport virtualRun = replayScriptedSessions(500, 200, processNextEventVirtual);
+      ReplayReport tableRun = replayScriptedSessions(500, 200);
+      cout << "virtual-call states     : " << (long long)(virtualRun.events / virtualRun.seconds)
+           << " transitions/s over " << virtualRun.events << " events" << endl;
+      cout << "fsm::StateMachine table : " << (long long)(tableRun.events / tableRun.seconds)
+           << " transitions/s over " << tableRun.events << " events" << endl;
+      bool sameOutcome = virtualRun.events == tableRun.events
+                         && virtualRun.debited == tableRun.debited
+                         && virtualRun.dispensed == tableRun.dispensed;
+      cout << "Every ATM back in Idle state: " << (tableRun.allIdle && virtualRun.allIdle ? "YES" : "NO")
+           << " | debited Rs " << tableRun.debited << ", dispensed Rs " << tableRun.dispensed
+           << " | same outcome both ways: " << (sameOutcome ? "YES" : "NO") << endl;
+    }
+
+    // =====================================================
+    cout << "\n--- CASE 13: Transaction Journal and Crash Recovery ---\n";
+    {
+      // A retried request with the same idempotency key pays out once.
+      const string demoPath = "atm_journal_demo.log";
+      remove(demoPath.c_str());
+      {
+        ATMJournal journal(demoPath);
+        ATMMachine journaled;
+        journaled.setConsoleInput(false);
+        journaled.setOutput(nullptr);
+        journaled.attachJournal(&journal);
+        Account retried("RTY001", Money::rupees(1000));
+        Card retriedCard("RTYCARD", "RTY001");
+        journaled.addAccount(&retried);
+        journaled.enrollCard(&retriedCard, 7777);
+
+        ATMEventLoop loop;
+        for(int attempt = 0; attempt < 2; attempt++){
+          postScriptedSession(loop, &journaled, &retriedCard, 7777, 0, 300);
+          loop.run();
+        }
+        ATMEvent confirm{CONFIRMED};
+        confirm.requestKey = 42;
+        for(int attempt = 0; attempt < 2; attempt++){
+          ATMEvent insert{CARD_INSERTED};
+          insert.card = &retriedCard;
+          ATMEvent select{OPERATION_SELECTED};
+          ATMEvent number{NUMBER_ENTERED};
+          number.value = 7777;
+          loop.post(&journaled, insert);
+          loop.post(&journaled, select);
+          loop.post(&journaled, number);
+          loop.post(&journaled, select);
+          number.value = 100;
+          loop.post(&journaled, number);
+          loop.post(&journaled, confirm);
+          loop.post(&journaled, ATMEvent{CARD_REMOVED});
+          loop.run();
+        }
+        cout << "Rs 1000 - 2 x Rs 300 - Rs 100 (key 42 sent twice) = Rs "
+             << retried.getBalance() << endl;
+      }
+      remove(demoPath.c_str());
+
+#if defined(__linux__)
+      {
+        // A journal on a full disk: no INTENT, so no debit either.
+        ATMJournal fullDisk("/dev/full");
+        ATMMachine journaled;
+        journaled.setConsoleInput(false);
+        journaled.setOutput(nullptr);
+        journaled.attachJournal(&fullDisk);
+        Account refused("FUL001", Money::rupees(1000));
+        Card refusedCard("FULCARD", "FUL001");
+        journaled.addAccount(&refused);
+        journaled.enrollCard(&refusedCard, 7777);
+
+        ATMEventLoop loop;
+        postScriptedSession(loop, &journaled, &refusedCard, 7777, 0, 300);
+        loop.run();
+        cout << "Journal on a full disk: balance still Rs " << refused.getBalance()
+             << " | refused: " << (refused.getBalance() == Money::rupees(1000) ? "YES" : "NO")
+             << endl;
+      }
+#endif
+
+      // 1M records, then a crash that leaves transactions open.
+      const string path = "atm_journal_bench.log";
+      remove(path.c_str());
+      const int accountCount = 1000;
+      const long long openingPaise = Money::rupees(1000000).inMinor();
+      vector<long long> expectedDebit(accountCount, 0);
+      const int transactions = 333333;
+
+      double appendSeconds;
+      {
+        ATMJournal journal(path, 4096);
+        mt19937 rng(13);
+        auto start = chrono::steady_clock::now();
+        for(int t = 0; t < transactions; t++){
+          int idx = rng() % accountCount;
+          long long paise = (long long)(1 + rng() % 100) * 1000;
+          string accountNumber = "JRN" + to_string(idx);
+          uint64_t key = journal.newKey();
+          journal.append(TXN_INTENT, key, accountNumber, Money::fromMinor(paise));
+          journal.append(TXN_DISPENSED, key, accountNumber, Money::fromMinor(paise));
+          journal.append(TXN_COMMITTED, key, accountNumber, Money::fromMinor(paise));
+          expectedDebit[idx] += paise;
+        }
+        journal.commit();
+        appendSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        // Crash: 5 withdrawals stopped before dispensing, 5 after.
+        for(int t = 0; t < 10; t++){
+          string accountNumber = "JRN" + to_string(t);
+          uint64_t key = journal.newKey();
+          journal.append(TXN_INTENT, key, accountNumber, Money::rupees(500));
+          if(t >= 5){
+            journal.append(TXN_DISPENSED, key, accountNumber, Money::rupees(500));
+            expectedDebit[t] += 50000;
+          }
+        }
+        journal.commit();
+      }
+      {
+        FILE* torn = fopen(path.c_str(), "ab");
+        fwrite("half a record", 1, 13, torn);
+        fclose(torn);
+      }
+
+      auto recoverInto = [&](AccountLedger& ledger, vector<Account*>& accounts){
+        for(int i = 0; i < accountCount; i++){
+          accounts.push_back(new Account("JRN" + to_string(i), Money::fromMinor(openingPaise)));
+          ledger.addAccount(accounts.back());
+        }
+        ATMJournal journal(path);
+        return journal.recover(ledger);
+      };
+
+      AccountLedger recovered;
+      vector<Account*> recoveredAccounts;
+      auto start = chrono::steady_clock::now();
+      RecoveryReport report = recoverInto(recovered, recoveredAccounts);
+      double recoverSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+      bool balancesMatch = true;
+      for(int i = 0; i < accountCount; i++)
+        if(recoveredAccounts[i]->getBalance().inMinor() != openingPaise - expectedDebit[i])
+          balancesMatch = false;
+
+      cout << report.records << " records appended at "
+           << appendSeconds * 1e9 / (3.0 * transactions) << " ns/record (fsync per 4096) | "
+           << "recovered in " << recoverSeconds * 1000 << " ms" << endl;
+      cout << report.transactions << " transactions: " << report.committed << " committed, "
+           << report.completed << " completed after dispense, " << report.rolledBack
+           << " rolled back, " << report.unapplied << " unapplied" << endl;
+
+      AccountLedger replayed;
+      vector<Account*> replayedAccounts;
+      RecoveryReport second = recoverInto(replayed, replayedAccounts);
+      bool sameAgain = second.completed == 0 && second.rolledBack == 0;
+      for(int i = 0; i < accountCount; i++)
+        if(replayedAccounts[i]->getBalance().inMinor() != recoveredAccounts[i]->getBalance().inMinor())
+          sameAgain = false;
+
+      cout << "Balances match the journal: " << (balancesMatch && report.written ? "YES" : "NO")
+           << " | second recovery finds nothing open: " << (sameAgain ? "YES" : "NO") << endl;
+      remove(path.c_str());
+    }
+
+    // =====================================================
+    cout << "\n--- CASE 14: Headless Fleet Simulation (JSON) ---\n";
+    {
+      FleetConfig config;
+      cout << ATMFleetSimulator::run(config).toJson() << endl;
+
+      config.amounts = HEAVY_TAIL;
+      config.minAmount = 10;
+      config.maxAmount = 10000;
+      config.sessions = 100000;
+      config.notesPerCassette = 2000;
+      config.depletionSamples = 4;
+      cout << ATMFleetSimulator::run(config).toJson() << endl;
+    }
+
+    // =====================================================
+    cout << "\n--- CASE 15: Card Directory with Hashed PINs and Lockout ---\n";
+    {
+      // Lockout through the normal session flow.
+      Account guarded("LCK001", Money::rupees(2000));
+      Card guardedCard("LCKCARD", "LCK001");
+
+      ATMMachine secured;
+      secured.setConsoleInput(false);
+      secured.setOutput(nullptr);
+      secured.addAccount(&guarded);
+      secured.enrollCard(&guardedCard, 2468);
+      CardDirectory& directory = *secured.getCardDirectory();
+      ATMEventLoop loop;
+      postScriptedSession(loop, &secured, &guardedCard, 2468, 0, 500);    // ok
+      for(int attempt = 0; attempt < 3; attempt++)
+        postScriptedSession(loop, &secured, &guardedCard, 2468, 2, 0);   // wrong PIN
+      postScriptedSession(loop, &secured, &guardedCard, 2468, 0, 500);    // blocked
+      loop.run();
+      cout << "1 withdrawal, 3 wrong PINs, then the right PIN: balance Rs "
+           << guarded.getBalance() << ", card "
+           << (directory.authenticate("LCKCARD", 2468).result == AUTH_BLOCKED ? "BLOCKED" : "open")
+           << endl;
+
+      // Authentication cost over a large directory. The full
+      // 10M-card run takes ~1 GB and ~10 s, so it is opt-in:
+      // ATM_DIRECTORY_CARDS=10000000 ./atm
+      const char* cardsSetting = getenv("ATM_DIRECTORY_CARDS");
+      const int cardCount = max(20000, cardsSetting ? atoi(cardsSetting) : 500000);
+      const int accountCount = 100000;
+      vector<Account*> accounts;
+      for(int i = 0; i < accountCount; i++)
+        accounts.push_back(new Account("DIR" + to_string(i), Money::rupees(1000)));
+      auto cardNumberOf = [](int i){
+        string number = to_string(i);
+        return "4" + string(14 - number.size(), '0') + number;   // 15 chars
+      };
+
+      auto* large = new CardDirectory();
+      large->reserve(cardCount);
+      auto b0 = chrono::steady_clock::now();
+      for(int i = 0; i < cardCount; i++)
+        large->enroll(cardNumberOf(i), 1000 + i % 9000, accounts[i % accountCount]);
+      double buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - b0).count();
+
+      // Requests drawn from 10k hot cards, then from all cards.
+      const int lookups = 2000000;
+      mt19937 rng(15);
+      vector<int> hotRequests(lookups), coldRequests(lookups);
+      for(int i = 0; i < lookups; i++){
+        hotRequests[i] = (int)((long long)(rng() % 10000) * 997 % cardCount);
+        coldRequests[i] = (int)(rng() % cardCount);
+      }
+      auto timeDirectory = [&](const vector<int>& requests, long long& ok){
+        vector<string> numbers;
+        numbers.reserve(requests.size());
+        for(int r : requests) numbers.push_back(cardNumberOf(r));
+        auto t0 = chrono::steady_clock::now();
+        for(size_t i = 0; i < requests.size(); i++)
+          if(large->authenticate(numbers[i], 1000 + requests[i] % 9000).result == AUTH_OK)
+            ok++;
+        return chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / requests.size();
+      };
+
+      long long ok = 0;
+      double hotNanos = timeDirectory(hotRequests, ok);
+      double coldNanos = timeDirectory(coldRequests, ok);
+
+      cout << cardCount << " cards enrolled in " << buildSeconds << " s" << endl;
+      cout << "directory, 10k hot cards (cached)   : " << hotNanos << " ns/auth" << endl;
+      cout << "directory, any of " << cardCount << " cards  : " << coldNanos << " ns/auth"
+           << " | all authenticated: " << (ok == 2LL * lookups ? "YES" : "NO") << endl;
+
+      delete large;
+      for(Account* account : accounts) delete account;
+    }
+
+    // =====================================================
+    cout << "\n--- CASE 16: Money (Integer Paise) vs double Balances ---\n";
+    {
+      // Exactness: ten deposits of Rs 0.10.
+      double doubleBalance = 0;
+      Money moneyBalance;
+      for(int i = 0; i < 10; i++){
+        doubleBalance += 0.10;
+        moneyBalance += Money::fromMinor(10);
+      }
+      cout << "10 x Rs 0.10 == Rs 1 | double: " << (doubleBalance == 1.0 ? "YES" : "NO")
+           << " | Money: " << (moneyBalance == Money::rupees(1) ? "YES" : "NO") << endl;
+
+      try {
+        Money huge = Money::fromMinor(INT64_MAX - 5);
+        huge += Money::rupees(1);
+        cout << "Overflow went unnoticed" << endl;
+      } catch(const overflow_error&) {
+        cout << "Overflow past INT64_MAX paise: caught" << endl;
+      }
+
+      // Ledger hot path: check-and-debit over many balances.
+      const int accountCount = 4096;
+      const int operations = 20000000;
+      vector<double> doubleLedger(accountCount, 50000.0);
+      vector<Money> moneyLedger(accountCount, Money::rupees(50000));
+      vector<Account*> accountLedger;
+      for(int i = 0; i < accountCount; i++)
+        accountLedger.push_back(new Account("MNY" + to_string(i), Money::rupees(50000)));
+
+      vector<int> amounts(1 << 16);
+      mt19937 rng(16);
+      for(int& amount : amounts) amount = 1 + rng() % 500;
+
+      long long doubleOk = 0, moneyOk = 0, accountOk = 0;
+      auto m0 = chrono::steady_clock::now();
+      for(int i = 0; i < operations; i++){
+        double& balance = doubleLedger[i & (accountCount - 1)];
+        double amount = amounts[i & 0xFFFF];
+        if(balance >= amount){ balance -= amount; doubleOk++; }
+      }
+      auto m1 = chrono::steady_clock::now();
+      for(int i = 0; i < operations; i++){
+        Money& balance = moneyLedger[i & (accountCount - 1)];
+        Money amount = Money::rupees(amounts[i & 0xFFFF]);
+        if(balance >= amount){ balance -= amount; moneyOk++; }
+      }
+      auto m2 = chrono::steady_clock::now();
+      for(int i = 0; i < operations; i++)
+        if(accountLedger[i & (accountCount - 1)]->withdraw(Money::rupees(amounts[i & 0xFFFF])))
+          accountOk++;
+      auto m3 = chrono::steady_clock::now();
+
+      auto perOp = [&](chrono::steady_clock::duration d){
+        return chrono::duration<double, nano>(d).count() / operations;
+      };
+      cout << "check-and-debit | double: " << perOp(m1 - m0) << " ns"
+           << " | Money: " << perOp(m2 - m1) << " ns"
+           << " | Account (atomic Money): " << perOp(m3 - m2) << " ns"
+           << " | same approvals: " << (doubleOk == moneyOk && moneyOk == accountOk ? "YES" : "NO")
+           << endl;
+      for(Account* account : accountLedger) delete account;
+    }
+
+    // =====================================================
+    cout << "\n--- CASE 17: Cassette Run-out Forecast from Telemetry ---\n";
+    {
+      const int atmCount = 1000;
+      const int simulatedHours = 96;
+      const int forecastHour = 8;
+      vector<ATMInventory*> fleet;
+      vector<double> demand;          // withdrawals per hour
+      mt19937 rng(17);
+      for(int a = 0; a < atmCount; a++){
+        fleet.push_back(new ATMInventory());
+        for(CashType type : DENOMINATIONS)
+          fleet.back()->loadCassette(type, 300);
+        demand.push_back(1 + rng() % 8);
+      }
+
+      ReplenishmentForecaster forecaster;
+      vector<CassetteForecast> forecasts;
+      vector<double> predictedEmptyHour(atmCount, INFINITY);
+      vector<int> actualEmptyHour(atmCount, -1);
+      double forecastMillis = 0;
+      int passes = 0;
+
+      for(int hour = 0; hour < simulatedHours; hour++){
+        for(int a = 0; a < atmCount; a++){
+          ATMInventory* atm = fleet[a];
+          atm->getTelemetry().advanceTo(hour);
+          poisson_distribution<int> arrivals(demand[a]);
+          for(int n = arrivals(rng); n > 0; n--)
+            atm->dispenseCash(Money::rupees(50 * (1 + rng() % 10)));
+          if(actualEmptyHour[a] < 0)
+            for(CashType type : DENOMINATIONS)
+              if(atm->getNotes(type) == 0){
+                actualEmptyHour[a] = hour;
+                break;
+              }
+        }
+
+        // Hourly re-forecast of the whole fleet.
+        auto f0 = chrono::steady_clock::now();
+        forecaster.forecastFleet(fleet, forecasts);
+        forecastMillis += chrono::duration<double, milli>(chrono::steady_clock::now() - f0).count();
+        passes++;
+
+        if(hour == forecastHour)
+          for(int a = 0; a < atmCount; a++)
+            predictedEmptyHour[a] = hour + forecasts[a].hoursUntilRefill;
+      }
+
+      int scored = 0;
+      double absoluteError = 0;
+      int flaggedEarly = 0;
+      int dryBeforeForecast = 0;
+      int neverDry = 0;
+      for(int a = 0; a < atmCount; a++){
+        if(actualEmptyHour[a] < 0){ neverDry++; continue; }
+        if(actualEmptyHour[a] <= forecastHour){ dryBeforeForecast++; continue; }
+        if(isinf(predictedEmptyHour[a])) continue;
+        scored++;
+        absoluteError += fabs(predictedEmptyHour[a] - actualEmptyHour[a]);
+        if(predictedEmptyHour[a] <= actualEmptyHour[a]) flaggedEarly++;
+      }
+
+      int busiest = (int)(max_element(demand.begin(), demand.end()) - demand.begin());
+      cout << atmCount << " ATMs, " << simulatedHours << " simulated hours | fleet forecast: "
+           << forecastMillis / passes << " ms per pass" << endl;
+      cout << "Before the forecast at hour " << forecastHour << ": " << dryBeforeForecast
+           << " ATMs already had a cassette run dry (not scored); "
+           << neverDry << " never ran dry" << endl;
+      cout << "Forecast vs first cassette to run dry, " << scored << " ATMs: mean error "
+           << (scored ? absoluteError / scored : 0) << " h, "
+           << flaggedEarly << " flagged in time (predicted on or before the hour it ran dry)" << endl;
+      cout << "Busiest ATM (" << demand[busiest] << " withdrawals/h): Rs "
+           << DENOMINATIONS[forecasts[busiest].firstToEmpty >= 0 ? forecasts[busiest].firstToEmpty : 0]
+           << " cassette is the limiting one, first ran dry at hour " << actualEmptyHour[busiest] << endl;
+
+      for(ATMInventory* atm : fleet) delete atm;
+    }
+
+    // =====================================================
+    cout << "\n--- CASE 18: Statement History and Daily Withdrawal Limit ---\n";
+    {
+      AccountLedger ledger;
+      Account* saver = new Account("HIST1", Money::rupees(100000));
+      saver->setDailyLimit(Money::rupees(10000));
+      ledger.addAccount(saver);
+      Card card("HISTCARD1", "HIST1");
+      CardDirectory directory;
+
+      ATMMachine branch(&ledger, &directory);
+      branch.enrollCard(&card, 4242);
+      branch.setAtmId(7);
+      branch.setConsoleInput(false);
+      branch.setOutput(nullptr);
+      branch.getInventory().refill(BILL_100, 500);
+      const int64_t monday = 20000 * Account::SECONDS_PER_DAY + 9 * 3600;
+
+      // Three Rs 4000 withdrawals on one day: the third is over
+      // the Rs 10000 limit; the next morning it goes through.
+      ATMEventLoop loop;
+      branch.pinClock(monday);
+      for(int i = 0; i < 3; i++)
+        postScriptedSession(loop, &branch, &card, 4242, 0, 4000);
+      loop.run();
+      branch.pinClock(monday + Account::SECONDS_PER_DAY);
+      postScriptedSession(loop, &branch, &card, 4242, 0, 4000);
+      loop.run();
+
+      // A negative amount must not reach the limit or the balance.
+      Money balanceBefore = saver->getBalance();
+      Money usedBefore = saver->withdrawnOnDay(20001);
+      postScriptedSession(loop, &branch, &card, 4242, 0, -500);
+      loop.run();
+      bool negativeRefused = saver->getBalance() == balanceBefore
+                             && saver->withdrawnOnDay(20001) == usedBefore
+                             && !saver->reserveDailyWithdrawal(Money::rupees(-500), 20001)
+                             && !saver->withdraw(Money::rupees(-500))
+                             && !saver->withdraw(Money())
+                             && !saver->deposit(Money::rupees(-500))
+                             && saver->getBalance() == balanceBefore;
+
+      cout << "Limit Rs " << saver->getDailyLimit() << " | refused on day 1: "
+           << branch.getCounters().dailyLimitHit << " | balance now Rs " << saver->getBalance()
+           << " | Rs -500 refused: " << (negativeRefused ? "YES" : "NO") << endl;
+      for(const HistoryEntry& row : saver->getHistory().lastEntries(5))
+        cout << "  day " << row.timestamp / Account::SECONDS_PER_DAY
+             << (row.type == HISTORY_WITHDRAWAL ? "  withdrawal Rs " : "  deposit Rs ")
+             << row.amount << " at ATM " << row.atmId << endl;
+
+      // A busy account: ten years of statement rows, then the
+      // queries an ATM or the bank app would run.
+      const int days = 3650;
+      const int rowsPerDay = 300;
+      Account busy("HIST2", Money::rupees(0));
+      AccountHistory& history = busy.getHistory();
+      history.reserve((size_t)days * rowsPerDay);
+      struct RowRecord{ int64_t timestamp; string type; double amount; string atm; };
+      vector<RowRecord> rowStore;
+      rowStore.reserve((size_t)days * rowsPerDay);
+      mt19937 rng(18);
+      for(int d = 0; d < days; d++){
+        for(int r = 0; r < rowsPerDay; r++){
+          int64_t timestamp = (20000 + d) * Account::SECONDS_PER_DAY + r * 280;
+          bool withdrawal = rng() % 4 != 0;
+          Money amount = Money::rupees(100 * (1 + rng() % 50));
+          uint32_t atm = rng() % 5000;
+          history.append(timestamp, withdrawal ? HISTORY_WITHDRAWAL : HISTORY_DEPOSIT, amount, atm);
+          if(withdrawal) busy.reserveDailyWithdrawal(amount, timestamp / Account::SECONDS_PER_DAY);
+          rowStore.push_back(RowRecord{timestamp, withdrawal ? "WITHDRAWAL" : "DEPOSIT",
+                                       (double)amount.wholeRupees(), "ATM-" + to_string(atm)});
+        }
+      }
+
+      const int64_t today = 20000 + days - 1;
+      const int queries = 2000;
+      volatile int64_t sink = 0;
+      auto q0 = chrono::steady_clock::now();
+      for(int i = 0; i < queries; i++)
+        sink = sink + busy.withdrawnOnDay(today).inMinor();
+      auto q1 = chrono::steady_clock::now();
+      for(int i = 0; i < queries; i++)
+        sink = sink + history.withdrawnBetween(today * Account::SECONDS_PER_DAY,
+                                               (today + 1) * Account::SECONDS_PER_DAY).inMinor();
+      auto q2 = chrono::steady_clock::now();
+      double rescanned = 0;
+      for(int i = 0; i < 20; i++){
+        rescanned = 0;
+        for(const RowRecord& row : rowStore)
+          if(row.timestamp / Account::SECONDS_PER_DAY == today && row.type == "WITHDRAWAL")
+            rescanned += row.amount;
+      }
+      auto q3 = chrono::steady_clock::now();
+      for(int i = 0; i < queries; i++)
+        sink = sink + history.lastEntries(10).size();
+      auto q4 = chrono::steady_clock::now();
+
+      auto nanosPer = [](chrono::steady_clock::duration d, int count){
+        return chrono::duration<double, nano>(d).count() / count;
+      };
+      size_t rows = history.size();
+      cout << rows << " statement rows | columnar: "
+           << (sizeof(int64_t) * 3 + sizeof(HistoryEntryType) + sizeof(uint32_t)) << " bytes/row"
+           << " | row structs: " << sizeof(RowRecord) << "+ bytes/row" << endl;
+      cout << "Withdrawn today | running aggregate: " << nanosPer(q1 - q0, queries) << " ns"
+           << " | range query: " << nanosPer(q2 - q1, queries) << " ns"
+           << " | rescan: " << nanosPer(q3 - q2, 20) / 1000 << " us"
+           << " | all agree: "
+           << (busy.withdrawnOnDay(today) == Money::rupees((int64_t)rescanned)
+               && history.withdrawnBetween(today * Account::SECONDS_PER_DAY,
+                                           (today + 1) * Account::SECONDS_PER_DAY) == busy.withdrawnOnDay(today)
+               ? "YES" : "NO") << endl;
+      cout << "Last 10 transactions: " << nanosPer(q4 - q3, queries) << " ns" << endl;
+      delete saver;
+    }
 
     cout << "\n========= ALL TEST CASES COMPLETED =========\n";
 
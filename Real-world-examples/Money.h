@@ -0,0 +1,157 @@
+/*
+===========================================================
+ MONEY – EXACT FIXED-POINT AMOUNTS
+===========================================================
+
+Shared by the ATM and Parking Lot designs.
+
+An amount is a signed 64-bit count of minor units (paise,
+100 to the rupee), so adding, comparing and debiting are
+plain integer operations and always exact - no 0.1 + 0.2
+surprises as with double.
+
+Every arithmetic operator checks for overflow and throws
+std::overflow_error instead of silently wrapping. On GCC
+and Clang the checks are compiler builtins, so the happy
+path costs one extra branch; other compilers get a plain
+range check against INT64_MIN / INT64_MAX.
+
+Money is constexpr throughout, so fee tables can still be
+verified with static_assert.
+===========================================================
+*/
+
+#ifndef LLD_MONEY_H
+#define LLD_MONEY_H
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+
+class Money {
+private:
+    int64_t minor;
+
+    constexpr explicit Money(int64_t minorUnits) : minor(minorUnits) {}
+
+#if defined(__GNUC__) || defined(__clang__)
+    static constexpr int64_t checkedAdd(int64_t a, int64_t b) {
+        int64_t result = 0;
+        if (__builtin_add_overflow(a, b, &result))
+            throw std::overflow_error("Money overflow");
+        return result;
+    }
+
+    static constexpr int64_t checkedSub(int64_t a, int64_t b) {
+        int64_t result = 0;
+        if (__builtin_sub_overflow(a, b, &result))
+            throw std::overflow_error("Money overflow");
+        return result;
+    }
+
+    static constexpr int64_t checkedMul(int64_t a, int64_t b) {
+        int64_t result = 0;
+        if (__builtin_mul_overflow(a, b, &result))
+            throw std::overflow_error("Money overflow");
+        return result;
+    }
+#else
+    static constexpr int64_t MAX = std::numeric_limits<int64_t>::max();
+    static constexpr int64_t MIN = std::numeric_limits<int64_t>::min();
+
+    static constexpr int64_t checkedAdd(int64_t a, int64_t b) {
+        if ((b > 0 && a > MAX - b) || (b < 0 && a < MIN - b))
+            throw std::overflow_error("Money overflow");
+        return a + b;
+    }
+
+    static constexpr int64_t checkedSub(int64_t a, int64_t b) {
+        if ((b < 0 && a > MAX + b) || (b > 0 && a < MIN + b))
+            throw std::overflow_error("Money overflow");
+        return a - b;
+    }
+
+    static constexpr int64_t checkedMul(int64_t a, int64_t b) {
+        if (a == 0 || b == 0)
+            return 0;
+        // MIN / -1 itself overflows, so the -1 cases are checked first.
+        if ((a == -1 && b == MIN) || (b == -1 && a == MIN))
+            throw std::overflow_error("Money overflow");
+        if (a > 0 ? (b > 0 ? a > MAX / b : b < MIN / a)
+                  : (b > 0 ? a < MIN / b : a < MAX / b))
+            throw std::overflow_error("Money overflow");
+        return a * b;
+    }
+#endif
+
+public:
+    static constexpr int64_t MINOR_PER_MAJOR = 100;
+
+    constexpr Money() : minor(0) {}
+
+    static constexpr Money fromMinor(int64_t paise) {
+        return Money(paise);
+    }
+
+    static constexpr Money rupees(int64_t amount) {
+        return Money(checkedMul(amount, MINOR_PER_MAJOR));
+    }
+
+    // Only for amounts arriving as decimals (user input, old
+    // APIs); rounds to the nearest paisa.
+    static Money fromDecimal(double amount) {
+        double paise = std::round(amount * MINOR_PER_MAJOR);
+        if (!(paise >= -9.2e18 && paise <= 9.2e18))
+            throw std::overflow_error("Money overflow");
+        return Money(static_cast<int64_t>(paise));
+    }
+
+    constexpr int64_t inMinor() const { return minor; }
+
+    // Whole rupees, rounded toward zero.
+    constexpr int64_t wholeRupees() const { return minor / MINOR_PER_MAJOR; }
+
+    constexpr bool isWholeRupees() const { return minor % MINOR_PER_MAJOR == 0; }
+
+    constexpr bool isZero() const { return minor == 0; }
+    constexpr bool isNegative() const { return minor < 0; }
+
+    constexpr Money operator+(Money other) const { return Money(checkedAdd(minor, other.minor)); }
+    constexpr Money operator-(Money other) const { return Money(checkedSub(minor, other.minor)); }
+    constexpr Money operator-() const { return Money(checkedSub(0, minor)); }
+    constexpr Money operator*(int64_t factor) const { return Money(checkedMul(minor, factor)); }
+
+    constexpr Money& operator+=(Money other) { minor = checkedAdd(minor, other.minor); return *this; }
+    constexpr Money& operator-=(Money other) { minor = checkedSub(minor, other.minor); return *this; }
+
+    constexpr bool operator==(Money other) const { return minor == other.minor; }
+    constexpr bool operator!=(Money other) const { return minor != other.minor; }
+    constexpr bool operator<(Money other) const { return minor < other.minor; }
+    constexpr bool operator<=(Money other) const { return minor <= other.minor; }
+    constexpr bool operator>(Money other) const { return minor > other.minor; }
+    constexpr bool operator>=(Money other) const { return minor >= other.minor; }
+};
+
+constexpr Money operator*(int64_t factor, Money amount) {
+    return amount * factor;
+}
+
+// "45" for whole rupees, "45.50" otherwise.
+inline std::ostream& operator<<(std::ostream& out, Money amount) {
+    int64_t minor = amount.inMinor();
+    uint64_t magnitude = minor < 0 ? 0 - static_cast<uint64_t>(minor) : minor;
+    if (minor < 0)
+        out << '-';
+    out << magnitude / Money::MINOR_PER_MAJOR;
+    uint64_t paise = magnitude % Money::MINOR_PER_MAJOR;
+    if (paise != 0)
+        out << '.' << (paise < 10 ? "0" : "") << paise;
+    return out;
+}
+
+static_assert(sizeof(Money) == sizeof(int64_t), "Money must stay one machine word");
+static_assert(Money::rupees(45) == Money::fromMinor(4500), "rupees are 100 paise");
+
+#endif
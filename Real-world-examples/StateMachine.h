@@ -0,0 +1,213 @@
+/*
+===========================================================
+ STATE MACHINE – COMPILE-TIME TRANSITION TABLES
+===========================================================
+
+Shared by the Vending Machine and ATM designs.
+
+States and events are empty tag types listed in fsm::List;
+their position in the list is their dense id. A machine is
+a list of rows:
+
+    Row<From, Event, action, To...>
+
+"in state From, on Event, run action, then go to To[i]",
+where i is the action's return value. An action is a plain
+function  int action(Context&, const Payload&)  and can be
+nullptr for a bare transition (always To[0]). Giving several
+targets is how an action chooses between outcomes, e.g.
+<Dispensing, HasCoin> for "paid enough" / "not yet".
+
+The (state x event) table is built at compile time; two rows
+for the same pair, or a target that is not a listed state,
+fail to compile. Dispatch is one array load and one indirect
+call - no virtual calls and no state objects on the heap.
+Cells with no row ignore the event.
+
+The current state is a single StateId owned by the caller,
+so a machine holds one byte of fsm state.
+===========================================================
+*/
+
+#ifndef LLD_STATE_MACHINE_H
+#define LLD_STATE_MACHINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+namespace fsm {
+
+template <class... Ts>
+struct List {};
+
+typedef uint8_t StateId;
+
+static constexpr int MAX_BRANCHES = 4;
+
+template <class From, class Event, auto Action, class... To>
+struct Row {
+    static_assert(sizeof...(To) >= 1, "a row needs a target state");
+    static_assert(sizeof...(To) <= MAX_BRANCHES, "too many targets in one row");
+
+    typedef From from;
+    typedef Event event;
+    typedef List<To...> targets;
+    static constexpr auto action = Action;
+};
+
+namespace detail {
+
+template <class T, class L>
+struct IndexOf;
+
+template <class T>
+struct IndexOf<T, List<>> {
+    static_assert(sizeof(T) == 0, "type is not in the state or event list");
+    static constexpr int value = -1;
+};
+
+template <class T, class... Ts>
+struct IndexOf<T, List<T, Ts...>> {
+    static constexpr int value = 0;
+};
+
+template <class T, class U, class... Ts>
+struct IndexOf<T, List<U, Ts...>> {
+    static constexpr int value = 1 + IndexOf<T, List<Ts...>>::value;
+};
+
+template <class Context, class Payload>
+struct Cell {
+    int (*action)(Context&, const Payload&);
+    uint8_t branches;               // 0 = event ignored in this state
+    StateId targets[MAX_BRANCHES];
+};
+
+template <class Context, class Payload, int N>
+struct Table {
+    Cell<Context, Payload> cells[N];
+    bool duplicate;
+};
+
+template <class Context, class Payload, int EVENTS, class States, class Events,
+          class R, class... To, int N>
+constexpr void place(Table<Context, Payload, N>& table, List<To...>) {
+    typedef int (*Action)(Context&, const Payload&);
+    Cell<Context, Payload>& cell =
+        table.cells[IndexOf<typename R::from, States>::value * EVENTS
+                    + IndexOf<typename R::event, Events>::value];
+    if (cell.branches) table.duplicate = true;
+    if constexpr (std::is_same<decltype(R::action), const std::nullptr_t>::value) {
+        cell.action = nullptr;
+    } else {
+        static_assert(std::is_convertible<decltype(R::action), Action>::value,
+                      "action must be int(Context&, const Payload&)");
+        cell.action = R::action;
+    }
+    cell.branches = sizeof...(To);
+    const StateId ids[] = {StateId(IndexOf<To, States>::value)...};
+    for (size_t i = 0; i < sizeof...(To); i++) cell.targets[i] = ids[i];
+}
+
+template <class Context, class Payload, int STATES, int EVENTS,
+          class States, class Events, class... Rows>
+constexpr Table<Context, Payload, STATES * EVENTS> build() {
+    Table<Context, Payload, STATES * EVENTS> table{};
+    (place<Context, Payload, EVENTS, States, Events, Rows>(table, typename Rows::targets{}), ...);
+    return table;
+}
+
+} // namespace detail
+
+template <class Context, class Payload, class States, class Events, class... Rows>
+class StateMachine;
+
+template <class Context, class Payload, class... S, class... E, class... Rows>
+class StateMachine<Context, Payload, List<S...>, List<E...>, Rows...> {
+public:
+    static constexpr int STATES = sizeof...(S);
+    static constexpr int EVENTS = sizeof...(E);
+    static_assert(STATES >= 1 && STATES <= 256, "1 to 256 states");
+
+    typedef int (*Action)(Context&, const Payload&);
+
+    template <class T>
+    static constexpr StateId id = StateId(detail::IndexOf<T, List<S...>>::value);
+
+    template <class T>
+    static constexpr int eventId = detail::IndexOf<T, List<E...>>::value;
+
+private:
+    static constexpr detail::Table<Context, Payload, STATES * EVENTS> table =
+        detail::build<Context, Payload, STATES, EVENTS, List<S...>, List<E...>, Rows...>();
+
+    static_assert(!table.duplicate, "two rows for the same (state, event)");
+
+    static constexpr const detail::Cell<Context, Payload>& cell(StateId state, int event) {
+        return table.cells[state * EVENTS + event];
+    }
+
+public:
+    // Applies `event` in `state`; false if the state ignores it.
+    static bool dispatch(Context& context, StateId& state, int event, const Payload& payload) {
+        const detail::Cell<Context, Payload>& c = cell(state, event);
+        if (!c.branches) return false;
+        int branch = c.action ? c.action(context, payload) : 0;
+        if (branch < 0 || branch >= c.branches)
+            throw std::out_of_range("fsm: action chose a target the row does not have");
+        state = c.targets[branch];
+        return true;
+    }
+
+    template <class Event>
+    static bool process(Context& context, StateId& state, const Payload& payload) {
+        return dispatch(context, state, eventId<Event>, payload);
+    }
+
+    // ---- compile-time queries, for static_assert'ed invariants ----
+
+    static constexpr bool handles(StateId state, int event) {
+        return cell(state, event).branches != 0;
+    }
+
+    static constexpr int branches(StateId state, int event) {
+        return cell(state, event).branches;
+    }
+
+    // Where `branch` of the cell leads; `state` if it is ignored.
+    static constexpr StateId target(StateId state, int event, int branch = 0) {
+        return handles(state, event) ? cell(state, event).targets[branch] : state;
+    }
+
+    static constexpr Action action(StateId state, int event) {
+        return cell(state, event).action;
+    }
+
+    // Every (state, event) pair has a row.
+    static constexpr bool total() {
+        for (int s = 0; s < STATES; s++)
+            for (int e = 0; e < EVENTS; e++)
+                if (!handles(StateId(s), e)) return false;
+        return true;
+    }
+
+    static constexpr bool reachableFrom(StateId start) {
+        bool seen[STATES] = {};
+        seen[start] = true;
+        for (int round = 0; round < STATES; round++)
+            for (int s = 0; s < STATES; s++)
+                if (seen[s])
+                    for (int e = 0; e < EVENTS; e++)
+                        for (int b = 0; b < branches(StateId(s), e); b++)
+                            seen[target(StateId(s), e, b)] = true;
+        for (int s = 0; s < STATES; s++)
+            if (!seen[s]) return false;
+        return true;
+    }
+};
+
+} // namespace fsm
+
+#endif
@@ -17,6 +17,16 @@ Two versions are included:
 2. Multi-Item Vending Machine
    - Multiple items with different prices & quantities
    - Realistic extension of the same design
+   - Items live in a slot-indexed ItemCatalog: a name is
+     resolved to a slot once, then price and quantity are
+     plain array reads
+   - Can report sales and refills, in batches, to a
+     central InventoryService shared by a whole fleet
+
+3. Concurrent Front Panel
+   - Coin mech, touchscreen and operator app post events
+     from their own threads; one drainer at a time applies
+     them, so both machines stay single-threaded
 
 -----------------------------------------------------------
 STATE DESIGN PATTERN:
@@ -25,14 +35,17 @@ based on its internal state without using large if-else
 or switch statements.
 
 - Context: VendingMachine
-- State Interface: VendingState
-- Concrete States:
-  NO_COIN, HAS_COIN, DISPENSING, SOLD_OUT
+- States: NO_COIN, HAS_COIN, DISPENSING, SOLD_OUT
 
 Each state:
 - Defines valid operations
 - Decides the next state
 
+The states are rows of a compile-time transition table
+(StateMachine.h, shared with the ATM design): one table
+lookup per event, with the table's invariants checked by
+static_assert.
+
 -----------------------------------------------------------
 PROBLEM STATEMENT:
 Design a vending machine that:
@@ -45,9 +58,9 @@ Design a vending machine that:
 
 -----------------------------------------------------------
 SOLUTION:
-- VendingMachine holds a reference to the current state
-- All actions are delegated to the current state object
-- State methods return the next state
+- VendingMachine holds the id of the current state
+- Every action is dispatched through the transition table
+- A row's action picks which of its next states to enter
 - Inventory and balance are updated during transitions
 
 This removes complex conditionals and keeps behavior
@@ -59,6 +72,16 @@ clean, extensible, and state-driven.
 #include <iostream>
 #include <string>
 #include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <cstdint>
+
+#include "StateMachine.h"
 using namespace std;
 
 /*
@@ -69,41 +92,24 @@ using namespace std;
 */
 namespace SimpleVM {
 
-class VendingMachine;
-class VendingState;
-
-class VendingState {
-public:
-    virtual VendingState* insertCoin(VendingMachine*, int) = 0;
-    virtual VendingState* selectItem(VendingMachine*) = 0;
-    virtual VendingState* dispense(VendingMachine*) = 0;
-    virtual VendingState* returnCoin(VendingMachine*) = 0;
-    virtual VendingState* refill(VendingMachine*, int) = 0;
-    virtual string getStateName() = 0;
-    virtual ~VendingState() = default;
-};
-
 class VendingMachine {
 private:
-    VendingState* currentState;
     int itemCount;
     int itemPrice;
     int insertedCoins;
 
-    VendingState* noCoinState;
-    VendingState* hasCoinState;
-    VendingState* dispenseState;
-    VendingState* soldOutState;
+    // Current state, an Fsm::Table id.
+    fsm::StateId state;
 
 public:
     VendingMachine(int count, int price);
 
     //SETTERS
-    void insertCoin(int c) { currentState = currentState->insertCoin(this, c); }
-    void selectItem() { currentState = currentState->selectItem(this); }
-    void dispense() { currentState = currentState->dispense(this); }
-    void returnCoin() { currentState = currentState->returnCoin(this); }
-    void refill(int q) { currentState = currentState->refill(this, q); }
+    void insertCoin(int c);
+    void selectItem();
+    void dispense();
+    void returnCoin();
+    void refill(int q);
     
     void decrementItemCount() { itemCount--; }
     void incrementItemCount(int q) { itemCount += q; }
@@ -114,118 +120,221 @@ public:
     int getCoins() { return insertedCoins; }
     int getItemCount() { return itemCount; }
     int getPrice() { return itemPrice; }
-
-    VendingState* getNoCoinState() { return noCoinState; }
-    VendingState* getHasCoinState() { return hasCoinState; }
-    VendingState* getDispenseState() { return dispenseState; }
-    VendingState* getSoldOutState() { return soldOutState; }
+    fsm::StateId getStateId() { return state; }
+    const char* getStateName();
 
     void printStatus();
 };
 
-class NoCoinState : public VendingState {
-public:
-    VendingState* insertCoin(VendingMachine* m, int c) override {
-        m->setCoins(c);
-        cout << "Coin inserted: Rs " << c << endl;
-        return m->getHasCoinState();
-    }
-    VendingState* selectItem(VendingMachine*) override {
-        cout << "Insert coin first\n";
-        return this;
-    }
-    VendingState* dispense(VendingMachine*) override {
-        cout << "No coin\n";
-        return this;
-    }
-    VendingState* returnCoin(VendingMachine*) override {
-        cout << "No coin to return\n";
-        return this;
-    }
-    VendingState* refill(VendingMachine* m, int q) override {
-        m->incrementItemCount(q);
-        return this;
+/* ---------------- TRANSITION TABLE ----------------
+ The machine's states as fsm rows. Events a state ignores
+ simply have no row.
+*/
+namespace Fsm {
+
+struct NoCoin {};
+struct HasCoin {};
+struct Dispensing {};
+struct SoldOut {};
+
+struct InsertCoin {};
+struct SelectItem {};
+struct Dispense {};
+struct ReturnCoin {};
+struct Refill {};
+
+inline int acceptFirstCoin(VendingMachine& m, const int& c) {
+    m.setCoins(c);
+    cout << "Coin inserted: Rs " << c << endl;
+    return 0;
+}
+inline int addCoin(VendingMachine& m, const int& c) { m.addCoins(c); return 0; }
+inline int insertCoinFirst(VendingMachine&, const int&) { cout << "Insert coin first\n"; return 0; }
+inline int noCoin(VendingMachine&, const int&) { cout << "No coin\n"; return 0; }
+inline int noCoinToReturn(VendingMachine&, const int&) { cout << "No coin to return\n"; return 0; }
+inline int soldOut(VendingMachine&, const int&) { cout << "Sold out\n"; return 0; }
+inline int restock(VendingMachine& m, const int& q) { m.incrementItemCount(q); return 0; }
+inline int returnCoins(VendingMachine& m, const int&) { m.setCoins(0); return 0; }
+
+// 0: paid, go dispense; 1: not enough yet.
+inline int payForItem(VendingMachine& m, const int&) {
+    if (m.getCoins() >= m.getPrice()) {
+        m.setCoins(0);
+        return 0;
     }
-    string getStateName() override { return "NO_COIN"; }
-};
+    cout << "Insufficient funds\n";
+    return 1;
+}
 
-class HasCoinState : public VendingState {
-public:
-    VendingState* insertCoin(VendingMachine* m, int c) override {
-        m->addCoins(c);
-        return this;
-    }
-    VendingState* selectItem(VendingMachine* m) override {
-        if (m->getCoins() >= m->getPrice()) {
-            m->setCoins(0);
-            return m->getDispenseState();
-        }
-        cout << "Insufficient funds\n";
-        return this;
-    }
-    VendingState* dispense(VendingMachine*) override {
-        return this;
-    }
-    VendingState* returnCoin(VendingMachine* m) override {
-        m->setCoins(0);
-        return m->getNoCoinState();
-    }
-    VendingState* refill(VendingMachine*, int) override {
-        return this;
-    }
-    string getStateName() override { return "HAS_COIN"; }
-};
+// 0: items left; 1: that was the last one.
+inline int dispenseItem(VendingMachine& m, const int&) {
+    m.decrementItemCount();
+    return m.getItemCount() > 0 ? 0 : 1;
+}
 
-class DispenseState : public VendingState {
-public:
-    VendingState* insertCoin(VendingMachine*, int) override { return this; }
-    VendingState* selectItem(VendingMachine*) override { return this; }
-    VendingState* dispense(VendingMachine* m) override {
-        m->decrementItemCount();
-        return (m->getItemCount() > 0)
-            ? m->getNoCoinState()
-            : m->getSoldOutState();
-    }
-    VendingState* returnCoin(VendingMachine*) override { return this; }
-    VendingState* refill(VendingMachine*, int) override { return this; }
-    string getStateName() override { return "DISPENSING"; }
-};
+typedef fsm::StateMachine<VendingMachine, int,
+    fsm::List<NoCoin, HasCoin, Dispensing, SoldOut>,
+    fsm::List<InsertCoin, SelectItem, Dispense, ReturnCoin, Refill>,
 
-class SoldOutState : public VendingState {
-public:
-    VendingState* insertCoin(VendingMachine*, int) override {
-        cout << "Sold out\n";
-        return this;
-    }
-    VendingState* selectItem(VendingMachine*) override { return this; }
-    VendingState* dispense(VendingMachine*) override { return this; }
-    VendingState* returnCoin(VendingMachine*) override { return this; }
-    VendingState* refill(VendingMachine* m, int q) override {
-        m->incrementItemCount(q);
-        return m->getNoCoinState();
-    }
-    string getStateName() override { return "SOLD_OUT"; }
-};
+    fsm::Row<NoCoin, InsertCoin, acceptFirstCoin, HasCoin>,
+    fsm::Row<NoCoin, SelectItem, insertCoinFirst, NoCoin>,
+    fsm::Row<NoCoin, Dispense,   noCoin,          NoCoin>,
+    fsm::Row<NoCoin, ReturnCoin, noCoinToReturn,  NoCoin>,
+    fsm::Row<NoCoin, Refill,     restock,         NoCoin>,
+
+    fsm::Row<HasCoin, InsertCoin, addCoin,     HasCoin>,
+    fsm::Row<HasCoin, SelectItem, payForItem,  Dispensing, HasCoin>,
+    fsm::Row<HasCoin, ReturnCoin, returnCoins, NoCoin>,
+
+    fsm::Row<Dispensing, Dispense, dispenseItem, NoCoin, SoldOut>,
+
+    fsm::Row<SoldOut, InsertCoin, soldOut, SoldOut>,
+    fsm::Row<SoldOut, Refill,     restock, NoCoin>
+> Table;
+
+static_assert(Table::reachableFrom(Table::id<NoCoin>), "unreachable vending state");
+static_assert(Table::target(Table::id<SoldOut>, Table::eventId<Refill>) == Table::id<NoCoin>,
+              "a refill must bring a sold-out machine back");
+
+} // namespace Fsm
 
 VendingMachine::VendingMachine(int c, int p) {
     itemCount = c;
     itemPrice = p;
     insertedCoins = 0;
 
-    noCoinState = new NoCoinState();
-    hasCoinState = new HasCoinState();
-    dispenseState = new DispenseState();
-    soldOutState = new SoldOutState();
+    state = (itemCount > 0) ? Fsm::Table::id<Fsm::NoCoin> : Fsm::Table::id<Fsm::SoldOut>;
+}
+
+void VendingMachine::insertCoin(int c) { Fsm::Table::process<Fsm::InsertCoin>(*this, state, c); }
+void VendingMachine::selectItem() { Fsm::Table::process<Fsm::SelectItem>(*this, state, 0); }
+void VendingMachine::dispense() { Fsm::Table::process<Fsm::Dispense>(*this, state, 0); }
+void VendingMachine::returnCoin() { Fsm::Table::process<Fsm::ReturnCoin>(*this, state, 0); }
+// Only a positive quantity is a refill: anything else would
+// bring a sold-out machine back with nothing to sell.
+void VendingMachine::refill(int q) {
+    if (q <= 0) return;
+    Fsm::Table::process<Fsm::Refill>(*this, state, q);
+}
 
-    currentState = (itemCount > 0) ? noCoinState : soldOutState;
+// Indexed by Fsm::Table state id.
+const char* VendingMachine::getStateName() {
+    static const char* const names[] = {"NO_COIN", "HAS_COIN", "DISPENSING", "SOLD_OUT"};
+    return names[state];
 }
 
 void VendingMachine::printStatus() {
-    cout << "State: " << currentState->getStateName()
+    cout << "State: " << getStateName()
          << " | Items: " << itemCount
          << " | Balance: Rs " << insertedCoins << endl;
 }
 
+/* ---------------- VIRTUAL-DISPATCH REFERENCE ----------------
+ The same machine as it was before Fsm::Table: one object
+ per state, one virtual call per event. It runs the table's
+ actions on a plain VendingMachine and is kept only so the
+ throughput benchmark can compare both designs.
+*/
+class ReferenceState {
+public:
+    virtual ~ReferenceState() {}
+    virtual const char* name() = 0;
+    // Each returns the next state; by default the event is ignored.
+    virtual ReferenceState* insertCoin(VendingMachine&, int) { return this; }
+    virtual ReferenceState* selectItem(VendingMachine&) { return this; }
+    virtual ReferenceState* dispense(VendingMachine&) { return this; }
+    virtual ReferenceState* returnCoin(VendingMachine&) { return this; }
+    virtual ReferenceState* refill(VendingMachine&, int) { return this; }
+};
+
+class ReferenceNoCoin : public ReferenceState {
+public:
+    const char* name() override { return "NO_COIN"; }
+    ReferenceState* insertCoin(VendingMachine& m, int c) override;
+    ReferenceState* selectItem(VendingMachine& m) override { Fsm::insertCoinFirst(m, 0); return this; }
+    ReferenceState* dispense(VendingMachine& m) override { Fsm::noCoin(m, 0); return this; }
+    ReferenceState* returnCoin(VendingMachine& m) override { Fsm::noCoinToReturn(m, 0); return this; }
+    ReferenceState* refill(VendingMachine& m, int q) override { Fsm::restock(m, q); return this; }
+};
+
+class ReferenceHasCoin : public ReferenceState {
+public:
+    const char* name() override { return "HAS_COIN"; }
+    ReferenceState* insertCoin(VendingMachine& m, int c) override { Fsm::addCoin(m, c); return this; }
+    ReferenceState* selectItem(VendingMachine& m) override;
+    ReferenceState* returnCoin(VendingMachine& m) override;
+};
+
+class ReferenceDispensing : public ReferenceState {
+public:
+    const char* name() override { return "DISPENSING"; }
+    ReferenceState* dispense(VendingMachine& m) override;
+};
+
+class ReferenceSoldOut : public ReferenceState {
+public:
+    const char* name() override { return "SOLD_OUT"; }
+    ReferenceState* insertCoin(VendingMachine& m, int c) override { Fsm::soldOut(m, c); return this; }
+    ReferenceState* refill(VendingMachine& m, int q) override;
+};
+
+struct ReferenceStates {
+    static ReferenceNoCoin noCoin;
+    static ReferenceHasCoin hasCoin;
+    static ReferenceDispensing dispensing;
+    static ReferenceSoldOut soldOut;
+};
+
+ReferenceNoCoin ReferenceStates::noCoin;
+ReferenceHasCoin ReferenceStates::hasCoin;
+ReferenceDispensing ReferenceStates::dispensing;
+ReferenceSoldOut ReferenceStates::soldOut;
+
+ReferenceState* ReferenceNoCoin::insertCoin(VendingMachine& m, int c) {
+    Fsm::acceptFirstCoin(m, c);
+    return &ReferenceStates::hasCoin;
+}
+
+ReferenceState* ReferenceHasCoin::selectItem(VendingMachine& m) {
+    return Fsm::payForItem(m, 0) == 0 ? (ReferenceState*)&ReferenceStates::dispensing : this;
+}
+
+ReferenceState* ReferenceHasCoin::returnCoin(VendingMachine& m) {
+    Fsm::returnCoins(m, 0);
+    return &ReferenceStates::noCoin;
+}
+
+ReferenceState* ReferenceDispensing::dispense(VendingMachine& m) {
+    return Fsm::dispenseItem(m, 0) == 0 ? (ReferenceState*)&ReferenceStates::noCoin
+                                        : &ReferenceStates::soldOut;
+}
+
+ReferenceState* ReferenceSoldOut::refill(VendingMachine& m, int q) {
+    Fsm::restock(m, q);
+    return &ReferenceStates::noCoin;
+}
+
+class ReferenceMachine {
+private:
+    VendingMachine data;    // counts and coins; its own state id is unused
+    ReferenceState* state;
+
+public:
+    ReferenceMachine(int count, int price)
+        : data(count, price),
+          state(count > 0 ? (ReferenceState*)&ReferenceStates::noCoin : &ReferenceStates::soldOut) {}
+
+    void insertCoin(int c) { state = state->insertCoin(data, c); }
+    void selectItem() { state = state->selectItem(data); }
+    void dispense() { state = state->dispense(data); }
+    void returnCoin() { state = state->returnCoin(data); }
+    void refill(int q) { if (q > 0) state = state->refill(data, q); }
+
+    int getCoins() { return data.getCoins(); }
+    int getItemCount() { return data.getItemCount(); }
+    const char* getStateName() { return state->name(); }
+};
+
 } // namespace SimpleVM
 
 /*
@@ -235,161 +344,851 @@ void VendingMachine::printStatus() {
 */
 namespace MultiVM {
 
-struct Item {
-    string name;
-    int price;
-    int quantity;
+// Items of one machine, interned into dense slots 0..size()-1
+// in the order they were first seen. Price and quantity live
+// in contiguous arrays indexed by slot; names are only read
+// when printing or resolving a name, so they sit in a cold
+// side table. A name is hashed once, by slotOf(); everything
+// after that is array indexing.
+class ItemCatalog {
+private:
+    vector<int> prices;
+    vector<int> quantities;
+    vector<int> skus;            // fleet-wide id, -1 until assigned
+    vector<string> names;        // cold
+    unordered_map<string, int> slotByName;
+    // Slots with quantity > 0; kept in step with every quantity
+    // change so the sold-out check never scans the catalog.
+    int inStock = 0;
+
+public:
+    static const int NO_SLOT = -1;
+
+    int size() const { return (int)prices.size(); }
+    bool isSlot(int slot) const { return slot >= 0 && slot < size(); }
+
+    int slotOf(const string& name) const {
+        auto it = slotByName.find(name);
+        return it == slotByName.end() ? NO_SLOT : it->second;
+    }
+
+    // Existing slot for `name`, or a new empty one.
+    int intern(const string& name) {
+        auto it = slotByName.find(name);
+        if (it != slotByName.end()) return it->second;
+        int slot = size();
+        slotByName[name] = slot;
+        prices.push_back(0);
+        quantities.push_back(0);
+        skus.push_back(-1);
+        names.push_back(name);
+        return slot;
+    }
+
+    // A stale or out-of-range slot reads as empty and free.
+    int price(int slot) const { return isSlot(slot) ? prices[slot] : 0; }
+    int quantity(int slot) const { return isSlot(slot) ? quantities[slot] : 0; }
+    int sku(int slot) const { return skus[slot]; }
+    const string& name(int slot) const { return names[slot]; }
+    int inStockCount() const { return inStock; }
+    const vector<int>& quantityArray() const { return quantities; }
+
+    void setPrice(int slot, int price) { prices[slot] = price; }
+    void setSku(int slot, int sku) { skus[slot] = sku; }
+
+    void setQuantity(int slot, int quantity) {
+        if (!isSlot(slot)) return;
+        inStock += (quantity > 0) - (quantities[slot] > 0);
+        quantities[slot] = quantity;
+    }
+};
+
+/* ---------------- FLEET INVENTORY SERVICE ----------------
+ Central stock and sales telemetry for a fleet of machines.
+ Machines never call the service per sale: each owns a
+ SalesBatcher that buffers StockEvents and ships them as one
+ batch. Per-machine stock is split over SHARDS locks by
+ machine id, so batches from different machines rarely
+ contend; fleet-wide per-SKU totals are plain atomics.
+*/
+
+inline int64_t steadyNanos() {
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct StockEvent {
+    int sku;
+    int delta;          // -1 for a sale, +q for a refill
+    int price;          // per unit, 0 for refills
+    int64_t atNanos;    // when it happened on the machine
+};
+
+class InventoryService {
+public:
+    static const int SHARDS = 64;
+    static const int MAX_SKUS = 1024;
+    // Latency samples kept per shard between drains; past this
+    // the shard keeps a uniform random sample (reservoir).
+    static const size_t LATENCY_SAMPLES = 4096;
+
+private:
+    struct MachineStock {
+        vector<int> quantity;   // by sku
+        long long sales = 0;
+        long long revenue = 0;
+    };
+
+    struct Shard {
+        mutex lock;
+        unordered_map<uint32_t, MachineStock> machines;
+        vector<int64_t> latencies;   // sale-to-applied, ns
+        long long latenciesSeen = 0;
+        uint64_t sampleState = 0x9E3779B97F4A7C15ull;
+    };
+
+    Shard shards[SHARDS];
+    mutex catalogLock;
+    unordered_map<string, int> skuIds;
+    atomic<long long> unitsBySku[MAX_SKUS];
+    atomic<long long> batches;
+    atomic<long long> busyNanos;   // time spent inside apply()
+
+    Shard& shardFor(uint32_t machineId) { return shards[machineId % SHARDS]; }
+
+    // Caller holds shard.lock.
+    static void sampleLatency(Shard& shard, int64_t nanos) {
+        long long seen = ++shard.latenciesSeen;
+        if (shard.latencies.size() < LATENCY_SAMPLES) {
+            shard.latencies.push_back(nanos);
+            return;
+        }
+        shard.sampleState ^= shard.sampleState << 13;   // xorshift64
+        shard.sampleState ^= shard.sampleState >> 7;
+        shard.sampleState ^= shard.sampleState << 17;
+        uint64_t pick = shard.sampleState % (uint64_t)seen;
+        if (pick < LATENCY_SAMPLES) shard.latencies[pick] = nanos;
+    }
+
+public:
+    InventoryService() : batches(0), busyNanos(0) {
+        for (auto& units : unitsBySku) units.store(0);
+    }
+
+    int registerSku(const string& name) {
+        lock_guard<mutex> guard(catalogLock);
+        auto it = skuIds.find(name);
+        if (it != skuIds.end()) return it->second;
+        if ((int)skuIds.size() == MAX_SKUS)
+            throw length_error("InventoryService: too many SKUs");
+        int id = (int)skuIds.size();
+        skuIds[name] = id;
+        return id;
+    }
+
+    void registerMachine(uint32_t machineId, const vector<pair<int, int>>& skuQuantities) {
+        Shard& shard = shardFor(machineId);
+        lock_guard<mutex> guard(shard.lock);
+        MachineStock& stock = shard.machines[machineId];
+        for (auto& sq : skuQuantities) {
+            if ((int)stock.quantity.size() <= sq.first) stock.quantity.resize(sq.first + 1, 0);
+            stock.quantity[sq.first] = sq.second;
+        }
+    }
+
+    // Applies one machine's batch under a single shard lock.
+    void apply(uint32_t machineId, const StockEvent* events, size_t count) {
+        int64_t entered = steadyNanos();
+        Shard& shard = shardFor(machineId);
+        {
+            lock_guard<mutex> guard(shard.lock);
+            MachineStock& stock = shard.machines[machineId];
+            for (size_t i = 0; i < count; i++) {
+                const StockEvent& e = events[i];
+                if ((int)stock.quantity.size() <= e.sku) stock.quantity.resize(e.sku + 1, 0);
+                stock.quantity[e.sku] += e.delta;
+                if (e.delta < 0) {
+                    stock.sales -= e.delta;
+                    stock.revenue -= (long long)e.delta * e.price;
+                }
+            }
+            int64_t now = steadyNanos();
+            for (size_t i = 0; i < count; i++)
+                if (events[i].delta < 0)
+                    sampleLatency(shard, now - events[i].atNanos);
+        }
+        // One atomic add per run of the same SKU, not per event.
+        for (size_t i = 0; i < count;) {
+            int sku = events[i].sku;
+            long long units = 0;
+            for (; i < count && events[i].sku == sku; i++)
+                if (events[i].delta < 0) units -= events[i].delta;
+            if (units) unitsBySku[sku].fetch_add(units, memory_order_relaxed);
+        }
+        batches.fetch_add(1, memory_order_relaxed);
+        busyNanos.fetch_add(steadyNanos() - entered, memory_order_relaxed);
+    }
+
+    int stockOf(uint32_t machineId, int sku) {
+        Shard& shard = shardFor(machineId);
+        lock_guard<mutex> guard(shard.lock);
+        auto it = shard.machines.find(machineId);
+        if (it == shard.machines.end() || (int)it->second.quantity.size() <= sku) return 0;
+        return it->second.quantity[sku];
+    }
+
+    long long unitsSold(int sku) { return unitsBySku[sku].load(); }
+    long long batchesApplied() { return batches.load(); }
+    long long busyNanosTotal() { return busyNanos.load(); }
+
+    long long totalRevenue() {
+        long long revenue = 0;
+        for (Shard& shard : shards) {
+            lock_guard<mutex> guard(shard.lock);
+            for (auto& machine : shard.machines) revenue += machine.second.revenue;
+        }
+        return revenue;
+    }
+
+    // Hands over the latency samples collected so far: every
+    // sale, or a random LATENCY_SAMPLES of them per shard.
+    vector<int64_t> drainLatencies() {
+        vector<int64_t> all;
+        for (Shard& shard : shards) {
+            lock_guard<mutex> guard(shard.lock);
+            all.insert(all.end(), shard.latencies.begin(), shard.latencies.end());
+            shard.latencies.clear();
+            shard.latenciesSeen = 0;
+        }
+        return all;
+    }
 };
 
-class VendingMachine;
-class VendingState;
+// Per-machine outbox. Flushes when the batch is full, or when
+// its oldest event is older than maxDelayNanos (checked on each
+// record and by flushIfStale, which the machine's owner calls
+// when idle).
+class SalesBatcher {
+private:
+    InventoryService* service;
+    uint32_t machineId;
+    size_t batchSize;
+    int64_t maxDelayNanos;
+    vector<StockEvent> pending;
 
-class VendingState {
 public:
-    virtual VendingState* insertCoin(VendingMachine*, int) = 0;
-    virtual VendingState* selectItem(VendingMachine*, const string&) = 0;
-    virtual VendingState* dispense(VendingMachine*) = 0;
-    virtual VendingState* returnCoin(VendingMachine*) = 0;
-    virtual VendingState* refill(VendingMachine*, const string&, int) = 0;
-    virtual string getStateName() = 0;
-    virtual ~VendingState() = default;
+    SalesBatcher(InventoryService* service, uint32_t machineId,
+                 size_t batchSize = 32, int64_t maxDelayNanos = 50000000)
+        : service(service), machineId(machineId),
+          batchSize(batchSize), maxDelayNanos(maxDelayNanos) {
+        pending.reserve(batchSize);
+    }
+
+    InventoryService* getService() { return service; }
+    uint32_t getMachineId() { return machineId; }
+
+    void record(int sku, int delta, int price) {
+        int64_t now = steadyNanos();
+        pending.push_back({sku, delta, price, now});
+        if (pending.size() >= batchSize || now - pending.front().atNanos >= maxDelayNanos)
+            flush();
+    }
+
+    void flushIfStale(int64_t now) {
+        if (!pending.empty() && now - pending.front().atNanos >= maxDelayNanos)
+            flush();
+    }
+
+    void flush() {
+        if (pending.empty()) return;
+        service->apply(machineId, pending.data(), pending.size());
+        pending.clear();
+    }
 };
 
 class VendingMachine {
 private:
-    VendingState* currentState;
-    unordered_map<string, Item> inventory;
-    Item* selectedItem = nullptr;
+    // Current state, an Fsm::Table id.
+    fsm::StateId state;
+    ItemCatalog catalog;
+    int selectedSlot = ItemCatalog::NO_SLOT;
     int coins = 0;
-
-    VendingState* noCoinState;
-    VendingState* hasCoinState;
-    VendingState* dispenseState;
-    VendingState* soldOutState;
+    SalesBatcher* salesBatcher = nullptr;
 
 public:
     VendingMachine();
 
-    void addItem(string name, int price, int quantity) {
-        inventory[name] = {name, price, quantity};
-        if (currentState == soldOutState && quantity > 0)
-            currentState = noCoinState;
+    // Returns the item's slot, usable with selectSlot/refillSlot.
+    int addItem(string name, int price, int quantity);
+
+    // Reports this machine's current stock, then every sale and
+    // refill, through the batcher's InventoryService.
+    void attachSalesBatcher(SalesBatcher* batcher) {
+        if (salesBatcher) salesBatcher->flush();
+        salesBatcher = batcher;
+        vector<pair<int, int>> stock;
+        for (int slot = 0; slot < catalog.size(); slot++) {
+            catalog.setSku(slot, batcher->getService()->registerSku(catalog.name(slot)));
+            stock.push_back({catalog.sku(slot), catalog.quantity(slot)});
+        }
+        batcher->getService()->registerMachine(batcher->getMachineId(), stock);
+    }
+
+    // Quantity changes go through here (or addItem) so they are
+    // reported and counted. Only positive quantities are added.
+    void restock(int slot, int q) {
+        if (!catalog.isSlot(slot) || q <= 0) return;
+        catalog.setQuantity(slot, catalog.quantity(slot) + q);
+        if (salesBatcher) {
+            if (catalog.sku(slot) < 0)
+                catalog.setSku(slot, salesBatcher->getService()->registerSku(catalog.name(slot)));
+            salesBatcher->record(catalog.sku(slot), q, 0);
+        }
+    }
+
+    void sellOne(int slot) {
+        catalog.setQuantity(slot, catalog.quantity(slot) - 1);
+        if (salesBatcher) salesBatcher->record(catalog.sku(slot), -1, catalog.price(slot));
     }
 
-    unordered_map<string, Item>& getInventory() { return inventory; }
-    Item* getSelectedItem() { return selectedItem; }
-    void setSelectedItem(Item* i) { selectedItem = i; }
+    const ItemCatalog& getCatalog() { return catalog; }
+    int getInStockItems() { return catalog.inStockCount(); }
+    bool hasStock() { return catalog.inStockCount() > 0; }
+    fsm::StateId getStateId() { return state; }
+    const char* getStateName();
+    int getSelectedSlot() { return selectedSlot; }
+    void setSelectedSlot(int slot) { selectedSlot = slot; }
 
     int getCoins() { return coins; }
     void setCoins(int c) { coins = c; }
     void addCoins(int c) { coins += c; }
 
-    VendingState* getNoCoinState() { return noCoinState; }
-    VendingState* getHasCoinState() { return hasCoinState; }
-    VendingState* getDispenseState() { return dispenseState; }
-    VendingState* getSoldOutState() { return soldOutState; }
-
-    void insertCoin(int c) { currentState = currentState->insertCoin(this, c); }
-    void selectItem(const string& n) { currentState = currentState->selectItem(this, n); }
-    void dispense() { currentState = currentState->dispense(this); }
-    void returnCoin() { currentState = currentState->returnCoin(this); }
-    void refill(const string& n, int q) { currentState = currentState->refill(this, n, q); }
+    void insertCoin(int c);
+    void selectItem(const string& n) { selectSlot(catalog.slotOf(n)); }
+    // A stale, negative or out-of-range slot is NO_SLOT.
+    void selectSlot(int slot);
+    void dispense();
+    void returnCoin();
+    // An unknown name gets a new, empty slot (price 0), but
+    // only in a state that accepts the refill. A quantity
+    // <= 0 is ignored.
+    void refill(const string& n, int q);
+    // A slot this catalog does not have is treated like an
+    // unknown name.
+    void refillSlot(int slot, int q);
 
     void printStatus();
 };
 
-class NoCoinState : public VendingState {
-public:
-    VendingState* insertCoin(VendingMachine* m, int c) override {
-        m->setCoins(c);
-        return m->getHasCoinState();
+/* ---------------- TRANSITION TABLE ----------------
+ The machine's states as fsm rows; events carry a coin amount
+ or refill quantity and an item slot.
+*/
+namespace Fsm {
+
+struct Input {
+    int value;   // coin amount or refill quantity
+    int slot;
+};
+
+struct NoCoin {};
+struct HasCoin {};
+struct Dispensing {};
+struct SoldOut {};
+
+struct InsertCoin {};
+struct SelectItem {};
+struct Dispense {};
+struct ReturnCoin {};
+struct Refill {};
+
+inline int acceptFirstCoin(VendingMachine& m, const Input& in) { m.setCoins(in.value); return 0; }
+inline int addCoin(VendingMachine& m, const Input& in) { m.addCoins(in.value); return 0; }
+inline int insertCoinFirst(VendingMachine&, const Input&) { cout << "Insert coin first\n"; return 0; }
+inline int restock(VendingMachine& m, const Input& in) { m.restock(in.slot, in.value); return 0; }
+inline int returnCoins(VendingMachine& m, const Input&) { m.setCoins(0); return 0; }
+
+// 0: the refill left something in stock; 1: still empty.
+inline int restockSoldOut(VendingMachine& m, const Input& in) {
+    m.restock(in.slot, in.value);
+    return m.hasStock() ? 0 : 1;
+}
+
+// 0: in stock and paid for, go dispense; 1: stay.
+inline int chooseItem(VendingMachine& m, const Input& in) {
+    const ItemCatalog& catalog = m.getCatalog();
+    if (in.slot == ItemCatalog::NO_SLOT) return 1;
+    if (catalog.quantity(in.slot) == 0 || m.getCoins() < catalog.price(in.slot)) return 1;
+    m.setSelectedSlot(in.slot);
+    return 0;
+}
+
+// 0: something is still in stock; 1: machine is now empty.
+inline int dispenseItem(VendingMachine& m, const Input&) {
+    m.sellOne(m.getSelectedSlot());
+    m.setCoins(0);
+    m.setSelectedSlot(ItemCatalog::NO_SLOT);
+    return m.hasStock() ? 0 : 1;
+}
+
+typedef fsm::StateMachine<VendingMachine, Input,
+    fsm::List<NoCoin, HasCoin, Dispensing, SoldOut>,
+    fsm::List<InsertCoin, SelectItem, Dispense, ReturnCoin, Refill>,
+
+    fsm::Row<NoCoin, InsertCoin, acceptFirstCoin, HasCoin>,
+    fsm::Row<NoCoin, SelectItem, insertCoinFirst, NoCoin>,
+    fsm::Row<NoCoin, Refill,     restock,         NoCoin>,
+
+    fsm::Row<HasCoin, InsertCoin, addCoin,     HasCoin>,
+    fsm::Row<HasCoin, SelectItem, chooseItem,  Dispensing, HasCoin>,
+    fsm::Row<HasCoin, ReturnCoin, returnCoins, NoCoin>,
+
+    fsm::Row<Dispensing, Dispense, dispenseItem, NoCoin, SoldOut>,
+
+    fsm::Row<SoldOut, Refill, restockSoldOut, NoCoin, SoldOut>
+> Table;
+
+static_assert(Table::reachableFrom(Table::id<SoldOut>), "unreachable vending state");
+static_assert(!Table::handles(Table::id<Dispensing>, Table::eventId<Refill>),
+              "no refills in the middle of a sale");
+
+} // namespace Fsm
+
+// ✅ Correct startup state
+VendingMachine::VendingMachine() : state(Fsm::Table::id<Fsm::SoldOut>) {}
+
+int VendingMachine::addItem(string name, int price, int quantity) {
+    int slot = catalog.intern(name);
+    catalog.setPrice(slot, price);
+    catalog.setQuantity(slot, quantity);
+    if (salesBatcher) {
+        // Pending sales of this item would otherwise be applied
+        // on top of the absolute quantity registered below.
+        salesBatcher->flush();
+        catalog.setSku(slot, salesBatcher->getService()->registerSku(name));
+        salesBatcher->getService()->registerMachine(salesBatcher->getMachineId(),
+                                                    {{catalog.sku(slot), quantity}});
+    }
+    if (state == Fsm::Table::id<Fsm::SoldOut> && quantity > 0)
+        state = Fsm::Table::id<Fsm::NoCoin>;
+    return slot;
+}
+
+void VendingMachine::insertCoin(int c) { Fsm::Table::process<Fsm::InsertCoin>(*this, state, {c, 0}); }
+void VendingMachine::selectSlot(int slot) {
+    if (!catalog.isSlot(slot)) slot = ItemCatalog::NO_SLOT;
+    Fsm::Table::process<Fsm::SelectItem>(*this, state, {0, slot});
+}
+void VendingMachine::dispense() { Fsm::Table::process<Fsm::Dispense>(*this, state, {0, 0}); }
+void VendingMachine::returnCoin() { Fsm::Table::process<Fsm::ReturnCoin>(*this, state, {0, 0}); }
+void VendingMachine::refillSlot(int slot, int q) {
+    if (q <= 0) return;
+    if (!catalog.isSlot(slot)) slot = ItemCatalog::NO_SLOT;
+    Fsm::Table::process<Fsm::Refill>(*this, state, {q, slot});
+}
+
+void VendingMachine::refill(const string& n, int q) {
+    if (q <= 0) return;
+    int slot = catalog.slotOf(n);
+    if (slot == ItemCatalog::NO_SLOT && Fsm::Table::handles(state, Fsm::Table::eventId<Fsm::Refill>))
+        slot = catalog.intern(n);
+    refillSlot(slot, q);
+}
+
+// Indexed by Fsm::Table state id.
+const char* VendingMachine::getStateName() {
+    static const char* const names[] = {"NO_COIN", "HAS_COIN", "DISPENSING", "SOLD_OUT"};
+    return names[state];
+}
+
+void VendingMachine::printStatus() {
+    cout << "State: " << getStateName()
+         << " | Balance: Rs " << coins << endl;
+    for (int slot = 0; slot < catalog.size(); slot++)
+        cout << "  " << catalog.name(slot) << " Qty: " << catalog.quantity(slot) << endl;
+}
+
+struct FleetBenchReport {
+    long long sales = 0;
+    double seconds = 0;
+    int64_t p50LatencyNanos = 0;
+    int64_t p99LatencyNanos = 0;
+    long long batches = 0;
+    double serviceNanosPerSale = 0;
+    bool consistent = false;
+};
+
+// Drives `machineCount` machines from `threads` workers, each
+// worker owning a disjoint slice of the fleet (so a machine is
+// only ever touched by one thread), with all sales reported to
+// one shared InventoryService.
+FleetBenchReport runFleetBenchmark(int machineCount, int threads, size_t batchSize,
+                                   int salesPerMachine) {
+    static const char* products[] = {"Water", "Coke", "Chips", "Candy", "Juice", "Coffee",
+                                     "Tea", "Soda", "Nuts", "Gum", "Cookies", "Mints"};
+    const int productCount = 12;
+    const int unitsPerProduct = salesPerMachine;   // enough that nothing sells out
+
+    InventoryService service;
+    vector<VendingMachine*> fleet;
+    vector<SalesBatcher*> batchers;
+    for (int m = 0; m < machineCount; m++) {
+        fleet.push_back(new VendingMachine());
+        for (int p = 0; p < productCount; p++)
+            fleet.back()->addItem(products[p], 10 + 5 * p, unitsPerProduct);
+        batchers.push_back(new SalesBatcher(&service, m, batchSize));
+        fleet.back()->attachSalesBatcher(batchers.back());
     }
-    VendingState* selectItem(VendingMachine*, const string&) override {
-        cout << "Insert coin first\n"; return this;
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            mt19937 rng(46 + t);
+            for (int round = 0; round < salesPerMachine; round++) {
+                for (int m = t; m < machineCount; m += threads) {
+                    int slot = rng() % productCount;
+                    fleet[m]->insertCoin(fleet[m]->getCatalog().price(slot));
+                    fleet[m]->selectSlot(slot);
+                    fleet[m]->dispense();
+                }
+                int64_t now = steadyNanos();
+                for (int m = t; m < machineCount; m += threads)
+                    batchers[m]->flushIfStale(now);
+            }
+            for (int m = t; m < machineCount; m += threads)
+                batchers[m]->flush();
+        });
+    }
+    for (thread& worker : workers) worker.join();
+
+    FleetBenchReport report;
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (int p = 0; p < productCount; p++)
+        report.sales += service.unitsSold(service.registerSku(products[p]));
+    report.batches = service.batchesApplied();
+    report.serviceNanosPerSale = (double)service.busyNanosTotal() / max(1LL, report.sales);
+
+    vector<int64_t> latencies = service.drainLatencies();
+    if (!latencies.empty()) {
+        sort(latencies.begin(), latencies.end());
+        report.p50LatencyNanos = latencies[latencies.size() / 2];
+        report.p99LatencyNanos = latencies[latencies.size() * 99 / 100];
     }
-    VendingState* dispense(VendingMachine*) override { return this; }
-    VendingState* returnCoin(VendingMachine*) override { return this; }
-    VendingState* refill(VendingMachine* m, const string& n, int q) override {
-        m->getInventory()[n].quantity += q;
-        return this;
+
+    // The service must agree with every machine's own inventory.
+    report.consistent = (report.sales == (long long)machineCount * salesPerMachine);
+    for (int m = 0; m < machineCount && report.consistent; m++) {
+        const ItemCatalog& catalog = fleet[m]->getCatalog();
+        for (int slot = 0; slot < catalog.size(); slot++)
+            if (service.stockOf(m, catalog.sku(slot)) != catalog.quantity(slot))
+                report.consistent = false;
     }
-    string getStateName() override { return "NO_COIN"; }
+
+    for (VendingMachine* machine : fleet) delete machine;
+    for (SalesBatcher* batcher : batchers) delete batcher;
+    return report;
+}
+
+struct FuzzReport {
+    long long steps = 0;
+    long long sales = 0;
+    long long violations = 0;
+    string firstViolation;
 };
 
-class HasCoinState : public VendingState {
-public:
-    VendingState* insertCoin(VendingMachine* m, int c) override {
-        m->addCoins(c); return this;
-    }
-    VendingState* selectItem(VendingMachine* m, const string& n) override {
-        auto& inv = m->getInventory();
-        if (!inv.count(n)) return this;
-        Item& i = inv[n];
-        if (i.quantity == 0 || m->getCoins() < i.price) return this;
-        m->setSelectedItem(&i);
-        return m->getDispenseState();
-    }
-    VendingState* dispense(VendingMachine*) override { return this; }
-    VendingState* returnCoin(VendingMachine* m) override {
-        m->setCoins(0);
-        return m->getNoCoinState();
-    }
-    VendingState* refill(VendingMachine*, const string&, int) override { return this; }
-    string getStateName() override { return "HAS_COIN"; }
+// Random operation sequences against one machine, with its
+// invariants checked after every step. `stocked` shadows the
+// units put in, so stock must always equal stocked - sales.
+FuzzReport fuzzMachine(uint32_t seed, long long steps) {
+    static const char* names[] = {"A", "B", "C", "D", "E", "F", "G", "H", "Z"};
+    const fsm::StateId noCoin = Fsm::Table::id<Fsm::NoCoin>;
+    const fsm::StateId dispensing = Fsm::Table::id<Fsm::Dispensing>;
+    const fsm::StateId soldOut = Fsm::Table::id<Fsm::SoldOut>;
+    VendingMachine m;
+    mt19937 rng(seed);
+    long long stocked = 0;
+    FuzzReport r;
+    auto fail = [&](const string& what) {
+        if (r.violations++ == 0)
+            r.firstViolation = what + " (seed " + to_string(seed) + ", step " + to_string(r.steps) + ")";
+    };
+
+    for (; r.steps < steps; r.steps++) {
+        fsm::StateId before = m.getStateId();
+        int op = rng() % 7;
+        string name = names[rng() % 9];
+        switch (op) {
+            case 0: m.insertCoin(5 * (1 + rng() % 8)); break;
+            case 1: m.selectItem(name); break;
+            case 2:
+                m.dispense();
+                if (before == dispensing) r.sales++;
+                break;
+            case 3: m.returnCoin(); break;
+            case 4: {
+                // Includes empty and negative refills, which must change nothing.
+                int q = static_cast<int>(rng() % 6) - 2;
+                int slots = m.getCatalog().size();
+                m.refill(name, q);
+                if (q > 0 && (before == noCoin || before == soldOut)) stocked += q;
+                else if (m.getCatalog().size() != slots) fail("refused refill added a slot");
+                if (q <= 0 && m.getStateId() != before) fail("empty refill changed state");
+                break;
+            }
+            case 5:
+                if (m.getCatalog().slotOf(name) == ItemCatalog::NO_SLOT) {
+                    int q = rng() % 4;
+                    m.addItem(name, 5 * (1 + rng() % 8), q);
+                    stocked += q;
+                }
+                break;
+            case 6: {
+                // Stale, negative or past-the-end slot.
+                static const int offsets[] = {-1, -7, 0, 5};
+                int offset = offsets[rng() % 4];
+                int slot = offset < 0 ? offset : m.getCatalog().size() + offset;
+                if (rng() % 2) {
+                    m.selectSlot(slot);
+                    if (m.getStateId() == dispensing && before != dispensing)
+                        fail("sold from a slot that does not exist");
+                } else {
+                    m.refillSlot(slot, static_cast<int>(rng() % 6) - 2);
+                }
+                break;
+            }
+        }
+
+        int recount = 0;
+        long long units = 0;
+        bool negative = false;
+        for (int quantity : m.getCatalog().quantityArray()) {
+            recount += quantity > 0;
+            units += quantity;
+            negative |= quantity < 0;
+        }
+        fsm::StateId now = m.getStateId();
+        if (recount != m.getInStockItems()) fail("in-stock count drifted");
+        if (negative) fail("negative quantity");
+        if (units != stocked - r.sales) fail("units not conserved");
+        if ((now == noCoin || now == soldOut) && m.getCoins() != 0) fail("coins kept while idle");
+        if (now == dispensing && (m.getSelectedSlot() == ItemCatalog::NO_SLOT
+                                  || m.getCatalog().quantity(m.getSelectedSlot()) <= 0))
+            fail("dispensing an item that is not in stock");
+        if (op == 2 && before == dispensing && (now == soldOut) == m.hasStock())
+            fail("wrong state after a sale");
+    }
+    return r;
+}
+
+} // namespace MultiVM
+
+/*
+=================================================================
+=        CONCURRENT FRONT PANEL (MULTIPLE INPUT SOURCES)         =
+=================================================================
+ Neither machine is thread-safe: the state, coins and the
+ quantities are plain fields. Every input source therefore
+ goes through a FrontPanel instead of calling the machine.
+
+ post() pushes the event on a lock-free multi-producer,
+ single-consumer queue (one atomic exchange) and returns at
+ once. Whichever poster then wins the `draining` flag applies
+ queued events one at a time until the queue is empty, so
+ events hit the machine strictly one after another, in an
+ order that keeps each source's own order: a linearizable
+ history of the machine.
+*/
+namespace Panel {
+
+enum PanelEventType : uint8_t {
+    INSERT_COIN,
+    SELECT_ITEM,
+    DISPENSE,
+    RETURN_COIN,
+    REFILL
+};
+
+struct PanelEvent {
+    PanelEventType type;
+    int value = 0;          // coin amount or refill quantity
+    int slot = 0;           // MultiVM item slot
+    uint16_t source = 0;    // input that posted it
+    uint32_t seq = 0;       // per-source sequence number
 };
 
-class DispenseState : public VendingState {
+inline void applyEvent(SimpleVM::VendingMachine& m, const PanelEvent& e) {
+    switch (e.type) {
+        case INSERT_COIN: m.insertCoin(e.value); break;
+        case SELECT_ITEM: m.selectItem(); break;
+        case DISPENSE:    m.dispense(); break;
+        case RETURN_COIN: m.returnCoin(); break;
+        case REFILL:      m.refill(e.value); break;
+    }
+}
+
+inline void applyEvent(SimpleVM::ReferenceMachine& m, const PanelEvent& e) {
+    switch (e.type) {
+        case INSERT_COIN: m.insertCoin(e.value); break;
+        case SELECT_ITEM: m.selectItem(); break;
+        case DISPENSE:    m.dispense(); break;
+        case RETURN_COIN: m.returnCoin(); break;
+        case REFILL:      m.refill(e.value); break;
+    }
+}
+
+inline void applyEvent(MultiVM::VendingMachine& m, const PanelEvent& e) {
+    switch (e.type) {
+        case INSERT_COIN: m.insertCoin(e.value); break;
+        case SELECT_ITEM: m.selectSlot(e.slot); break;
+        case DISPENSE:    m.dispense(); break;
+        case RETURN_COIN: m.returnCoin(); break;
+        case REFILL:      m.refillSlot(e.slot, e.value); break;
+    }
+}
+
+template <class Machine>
+class FrontPanel {
+private:
+    struct Node {
+        atomic<Node*> next{nullptr};
+        PanelEvent event;
+    };
+
+    Machine& machine;
+    atomic<Node*> head;            // newest node; producers swap in
+    Node* tail;                    // consumed stub; owned by the drainer
+    atomic<bool> draining{false};
+    atomic<long long> pending{0};
+    atomic<long long> applied{0};
+    vector<PanelEvent>* appliedLog = nullptr;
+
+    // Drainer only. False while the queue is empty, or while a
+    // producer has swapped `head` but not linked its node yet.
+    bool popOne(PanelEvent& out) {
+        Node* next = tail->next.load(memory_order_acquire);
+        if (!next) return false;
+        out = next->event;
+        delete tail;
+        tail = next;
+        return true;
+    }
+
 public:
-    VendingState* insertCoin(VendingMachine*, int) override { return this; }
-    VendingState* selectItem(VendingMachine*, const string&) override { return this; }
-    VendingState* dispense(VendingMachine* m) override {
-        Item* i = m->getSelectedItem();
-        i->quantity--;
-        m->setCoins(0);
-        m->setSelectedItem(nullptr);
-
-        for (auto& it : m->getInventory())
-            if (it.second.quantity > 0)
-                return m->getNoCoinState();
-
-        return m->getSoldOutState();
-    }
-    VendingState* returnCoin(VendingMachine*) override { return this; }
-    VendingState* refill(VendingMachine*, const string&, int) override { return this; }
-    string getStateName() override { return "DISPENSING"; }
+    FrontPanel(Machine& machine) : machine(machine) {
+        Node* stub = new Node();
+        head.store(stub);
+        tail = stub;
+    }
+
+    ~FrontPanel() {
+        drain();
+        delete tail;
+    }
+
+    // Appends every applied event, in order (for checking).
+    void recordTo(vector<PanelEvent>* log) { appliedLog = log; }
+
+    long long eventsApplied() { return applied.load(); }
+
+    void post(const PanelEvent& event) {
+        Node* node = new Node();
+        node->event = event;
+        Node* prev = head.exchange(node, memory_order_acq_rel);
+        prev->next.store(node, memory_order_release);
+        pending.fetch_add(1);
+        drain();
+    }
+
+    // A poster that loses the flag leaves its event to the
+    // current drainer, which re-checks `pending` after giving
+    // the flag up, so no event is stranded.
+    void drain() {
+        while (pending.load() > 0) {
+            bool expected = false;
+            if (!draining.compare_exchange_strong(expected, true)) return;
+            PanelEvent event;
+            while (popOne(event)) {
+                applyEvent(machine, event);
+                if (appliedLog) appliedLog->push_back(event);
+                pending.fetch_sub(1);
+                applied.fetch_add(1, memory_order_relaxed);
+            }
+            draining.store(false);
+        }
+    }
 };
 
-class SoldOutState : public VendingState {
+// Baseline for the stress test: one mutex around the machine.
+template <class Machine>
+class LockedPanel {
+private:
+    Machine& machine;
+    mutex lock;
+    vector<PanelEvent>* appliedLog = nullptr;
+
 public:
-    VendingState* insertCoin(VendingMachine*, int) override { return this; }
-    VendingState* selectItem(VendingMachine*, const string&) override { return this; }
-    VendingState* dispense(VendingMachine*) override { return this; }
-    VendingState* returnCoin(VendingMachine*) override { return this; }
-    VendingState* refill(VendingMachine* m, const string& n, int q) override {
-        m->getInventory()[n].quantity += q;
-        return m->getNoCoinState();
-    }
-    string getStateName() override { return "SOLD_OUT"; }
+    LockedPanel(Machine& machine) : machine(machine) {}
+
+    void recordTo(vector<PanelEvent>* log) { appliedLog = log; }
+
+    void post(const PanelEvent& event) {
+        lock_guard<mutex> guard(lock);
+        applyEvent(machine, event);
+        if (appliedLog) appliedLog->push_back(event);
+    }
 };
 
-VendingMachine::VendingMachine() {
-    noCoinState = new NoCoinState();
-    hasCoinState = new HasCoinState();
-    dispenseState = new DispenseState();
-    soldOutState = new SoldOutState();
+struct StressReport {
+    long long events = 0;
+    double seconds = 0;
+    bool sourceOrderKept = false;   // each source's events applied in its order
+    bool replayMatches = false;     // sequential replay ends in the same state
+};
 
-    // ✅ Correct startup state
-    currentState = soldOutState;
-}
+// `sources` threads each post `eventsPerSource` events made by
+// makeEvent(source, rng). The applied order is then replayed
+// on `replica` (built like `machine`) on one thread; the two
+// machines must end up identical.
+template <template <class> class PanelType, class Machine, class MakeEvent, class SameState>
+StressReport stressPanel(Machine& machine, Machine& replica, int sources, int eventsPerSource,
+                         MakeEvent makeEvent, SameState sameState) {
+    vector<PanelEvent> log;
+    log.reserve((size_t)sources * eventsPerSource);
+    StressReport report;
+    {
+        PanelType<Machine> panel(machine);
+        panel.recordTo(&log);
+        auto start = chrono::steady_clock::now();
+        vector<thread> inputs;
+        for (int source = 0; source < sources; source++) {
+            inputs.emplace_back([&, source]() {
+                mt19937 rng(49 + source);
+                for (int i = 0; i < eventsPerSource; i++) {
+                    PanelEvent event = makeEvent(source, rng);
+                    event.source = (uint16_t)source;
+                    event.seq = (uint32_t)i;
+                    panel.post(event);
+                }
+            });
+        }
+        for (thread& input : inputs) input.join();
+        report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
 
-void VendingMachine::printStatus() {
-    cout << "State: " << currentState->getStateName()
-         << " | Balance: Rs " << coins << endl;
-    for (auto& i : inventory)
-        cout << "  " << i.first << " Qty: " << i.second.quantity << endl;
+    report.events = (long long)log.size();
+    vector<long long> lastSeq(sources, -1);
+    report.sourceOrderKept = (report.events == (long long)sources * eventsPerSource);
+    for (const PanelEvent& event : log) {
+        if ((long long)event.seq <= lastSeq[event.source]) report.sourceOrderKept = false;
+        lastSeq[event.source] = event.seq;
+    }
+    for (const PanelEvent& event : log) applyEvent(replica, event);
+    report.replayMatches = sameState(machine, replica);
+    return report;
 }
 
-} // namespace MultiVM
+} // namespace Panel
 
 /*
 =================================================================
@@ -541,5 +1340,306 @@ int main() {
     mm.refill("Water", 2);
     mm.printStatus();
 
+    /* =========================================================
+       MULTI ITEM MACHINE : SOLD-OUT CHECK AND INVARIANT FUZZ
+       ========================================================= */
+    cout << "\n================ MULTI ITEM SOLD-OUT CHECK ================\n";
+
+    {
+        // 10k SKUs, all sold out but one: the worst case for a
+        // sold-out check that scans the inventory.
+        MultiVM::VendingMachine wide;
+        const int skuCount = 10000;
+        const int sales = 200000;
+        for (int i = 0; i < skuCount; i++) wide.addItem("SKU" + to_string(i), 10, 0);
+        wide.addItem("SKU" + to_string(skuCount / 2), 10, sales);
+
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < sales; i++) {
+            wide.insertCoin(10);
+            wide.selectItem("SKU" + to_string(skuCount / 2));
+            wide.dispense();
+        }
+        auto t1 = chrono::steady_clock::now();
+        const int scans = 2000;
+        long long found = 0;
+        for (int i = 0; i < scans; i++)
+            for (int quantity : wide.getCatalog().quantityArray())
+                if (quantity > 0) { found++; break; }
+        auto t2 = chrono::steady_clock::now();
+
+        cout << skuCount << " SKUs | sale with counted sold-out check: "
+             << chrono::duration<double, nano>(t1 - t0).count() / sales << " ns"
+             << " | an inventory scan would add: "
+             << chrono::duration<double, nano>(t2 - t1).count() / scans << " ns per sale"
+             << " | sold out after last unit: "
+             << (wide.getStateId() == MultiVM::Fsm::Table::id<MultiVM::Fsm::SoldOut> && found == 0 ? "YES" : "NO") << endl;
+    }
+
+    {
+        const int seeds = 8;
+        const long long stepsPerSeed = 250000;
+        long long steps = 0, sales = 0, violations = 0;
+        string firstViolation;
+        cout.setstate(ios::failbit);   // states print on bad input
+        auto f0 = chrono::steady_clock::now();
+        for (int seed = 1; seed <= seeds; seed++) {
+            MultiVM::FuzzReport r = MultiVM::fuzzMachine(seed, stepsPerSeed);
+            steps += r.steps;
+            sales += r.sales;
+            violations += r.violations;
+            if (firstViolation.empty()) firstViolation = r.firstViolation;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - f0).count();
+        cout.clear();
+        cout << "Fuzz: "
+             << steps << " random steps (" << sales << " sales) over " << seeds
+             << " seeds, " << (long long)(steps / seconds) << " steps/s with checks | invariant violations: "
+             << violations << (violations ? " - first: " + firstViolation : "") << endl;
+    }
+
+    /* =========================================================
+       MULTI ITEM MACHINE : SLOT CATALOG vs STRING-KEYED MAP
+       Same select / sell / refill stream against the old
+       unordered_map<string, Item> layout and the ItemCatalog,
+       by name (one hash) and by slot (no hash).
+       ========================================================= */
+    cout << "\n================ SLOT CATALOG vs STRING MAP ================\n";
+
+    {
+        struct MapItem { string name; int price; int quantity; };
+        const int skuCount = 64;
+        const int ops = 4000000;
+        const int coins = 50;
+        const int stock = 1000000;
+        vector<string> names;
+        unordered_map<string, MapItem> byName;
+        MultiVM::ItemCatalog catalog;
+        for (int i = 0; i < skuCount; i++) {
+            names.push_back("Snack product #" + to_string(i));
+            byName[names.back()] = {names.back(), 10 + i % 40, stock};
+            int slot = catalog.intern(names.back());
+            catalog.setPrice(slot, 10 + i % 40);
+            catalog.setQuantity(slot, stock);
+        }
+        vector<pair<bool, int>> stream(ops);   // (is refill, item)
+        mt19937 rng(48);
+        for (auto& op : stream) op = {rng() % 10 >= 7, (int)(rng() % skuCount)};
+
+        auto t0 = chrono::steady_clock::now();
+        for (auto& op : stream) {
+            const string& n = names[op.second];
+            if (op.first) { byName[n].quantity += 1; continue; }
+            if (!byName.count(n)) continue;             // as chooseItem does
+            MapItem& i = byName[n];
+            if (i.quantity > 0 && coins >= i.price) i.quantity--;
+        }
+        auto t1 = chrono::steady_clock::now();
+        for (auto& op : stream) {
+            int slot = catalog.slotOf(names[op.second]);
+            if (op.first) { catalog.setQuantity(slot, catalog.quantity(slot) + 1); continue; }
+            if (catalog.quantity(slot) > 0 && coins >= catalog.price(slot))
+                catalog.setQuantity(slot, catalog.quantity(slot) - 1);
+        }
+        auto t2 = chrono::steady_clock::now();
+        for (auto& op : stream) {
+            int slot = op.second;   // interned in the same order
+            if (op.first) { catalog.setQuantity(slot, catalog.quantity(slot) + 1); continue; }
+            if (catalog.quantity(slot) > 0 && coins >= catalog.price(slot))
+                catalog.setQuantity(slot, catalog.quantity(slot) - 1);
+        }
+        auto t3 = chrono::steady_clock::now();
+
+        bool same = true;
+        for (int i = 0; i < skuCount; i++)
+            same &= (catalog.quantity(i) - stock == 2 * (byName[names[i]].quantity - stock));
+        auto mops = [&](chrono::steady_clock::duration d) {
+            return ops / chrono::duration<double, micro>(d).count();
+        };
+        cout << "Catalog ops (M ops/s) | string map: " << mops(t1 - t0)
+             << " | catalog by name: " << mops(t2 - t1)
+             << " | catalog by slot: " << mops(t3 - t2)
+             << " | same stock changes: " << (same ? "YES" : "NO") << endl;
+
+        // Whole sales through the state machine, by name and by slot.
+        MultiVM::VendingMachine vm;
+        for (int i = 0; i < skuCount; i++) vm.addItem(names[i], 10 + i % 40, 1 << 20);
+        const int sales = 1000000;
+        auto s0 = chrono::steady_clock::now();
+        for (int i = 0; i < sales; i++) {
+            vm.insertCoin(coins);
+            vm.selectItem(names[i % skuCount]);
+            vm.dispense();
+        }
+        auto s1 = chrono::steady_clock::now();
+        for (int i = 0; i < sales; i++) {
+            vm.insertCoin(coins);
+            vm.selectSlot(i % skuCount);
+            vm.dispense();
+        }
+        auto s2 = chrono::steady_clock::now();
+        cout << "Machine sales (M/s) | selectItem(name): "
+             << sales / chrono::duration<double, micro>(s1 - s0).count()
+             << " | selectSlot(slot): "
+             << sales / chrono::duration<double, micro>(s2 - s1).count() << endl;
+    }
+
+    /* =========================================================
+       VENDING FLEET : SHARED INVENTORY SERVICE
+       10k machines on worker threads, reporting every sale to
+       one InventoryService; one event per call vs batches.
+       ========================================================= */
+    cout << "\n================ VENDING FLEET BENCHMARK ================\n";
+
+    const int fleetMachines = 10000;
+    const int fleetThreads = (int)max(1u, min(8u, thread::hardware_concurrency()));
+    cout << fleetMachines << " machines on " << fleetThreads << " worker thread(s)\n";
+    const int salesPerMachine = 100;
+    for (size_t batchSize : {(size_t)1, (size_t)32}) {
+        MultiVM::FleetBenchReport r =
+            MultiVM::runFleetBenchmark(fleetMachines, fleetThreads, batchSize, salesPerMachine);
+        cout << "batch " << batchSize << ": " << r.sales << " sales in " << r.seconds << " s = "
+             << (long long)(r.sales / r.seconds) << " sales/s | " << r.batches << " batches, service "
+             << r.serviceNanosPerSale << " ns/sale"
+             << " | update latency p50 " << r.p50LatencyNanos / 1000.0 << " us, p99 "
+             << r.p99LatencyNanos / 1000.0 << " us | service matches machines: "
+             << (r.consistent ? "YES" : "NO") << endl;
+    }
+
+    /* =========================================================
+       CONCURRENT FRONT PANEL : STRESS TEST
+       Coin mech, touchscreen and operator app as threads
+       posting to one machine; checked by sequential replay.
+       ========================================================= */
+    cout << "\n================ CONCURRENT FRONT PANEL ================\n";
+
+    {
+        const int sources = 3;   // 0 = coin mech, 1 = touchscreen, 2 = operator app
+        const int eventsPerSource = 300000;
+
+        auto simpleEvent = [](int source, mt19937& rng) {
+            Panel::PanelEvent e;
+            if (source == 0)      { e.type = Panel::INSERT_COIN; e.value = 10 * (1 + rng() % 2); }
+            else if (source == 1) e.type = (rng() % 2) ? Panel::SELECT_ITEM : Panel::DISPENSE;
+            else if (rng() % 4)   e.type = Panel::RETURN_COIN;
+            else                  { e.type = Panel::REFILL; e.value = 1 + rng() % 5; }
+            return e;
+        };
+        auto simpleSame = [](SimpleVM::VendingMachine& a, SimpleVM::VendingMachine& b) {
+            return a.getCoins() == b.getCoins() && a.getItemCount() == b.getItemCount()
+                && a.getStateId() == b.getStateId();
+        };
+
+        const int slots = 8;
+        auto multiEvent = [slots](int source, mt19937& rng) {
+            Panel::PanelEvent e;
+            e.slot = rng() % slots;
+            if (source == 0)      { e.type = Panel::INSERT_COIN; e.value = 5 * (1 + rng() % 8); }
+            else if (source == 1) e.type = (rng() % 2) ? Panel::SELECT_ITEM : Panel::DISPENSE;
+            else if (rng() % 4)   e.type = Panel::RETURN_COIN;
+            else                  { e.type = Panel::REFILL; e.value = 1 + rng() % 5; }
+            return e;
+        };
+        auto multiSame = [slots](MultiVM::VendingMachine& a, MultiVM::VendingMachine& b) {
+            bool same = a.getCoins() == b.getCoins()
+                && a.getStateId() == b.getStateId();
+            for (int slot = 0; slot < slots; slot++)
+                same &= a.getCatalog().quantity(slot) == b.getCatalog().quantity(slot);
+            return same;
+        };
+        auto stockMulti = [slots](MultiVM::VendingMachine& m) {
+            for (int slot = 0; slot < slots; slot++)
+                m.addItem("Item" + to_string(slot), 10 + 5 * slot, 50);
+        };
+
+        auto print = [](const string& label, const Panel::StressReport& r) {
+            cout << label << r.events << " events from 3 sources in " << r.seconds << " s = "
+                 << (long long)(r.events / r.seconds) << " events/s | source order kept: "
+                 << (r.sourceOrderKept ? "YES" : "NO") << " | replay matches: "
+                 << (r.replayMatches ? "YES" : "NO") << endl;
+        };
+
+        cout.setstate(ios::failbit);   // states print on bad input
+        SimpleVM::VendingMachine s1(1000, 20), s1Replica(1000, 20);
+        Panel::StressReport simpleQueue = Panel::stressPanel<Panel::FrontPanel>(
+            s1, s1Replica, sources, eventsPerSource, simpleEvent, simpleSame);
+        SimpleVM::VendingMachine s2(1000, 20), s2Replica(1000, 20);
+        Panel::StressReport simpleLocked = Panel::stressPanel<Panel::LockedPanel>(
+            s2, s2Replica, sources, eventsPerSource, simpleEvent, simpleSame);
+        MultiVM::VendingMachine m1, m1Replica;
+        stockMulti(m1);
+        stockMulti(m1Replica);
+        Panel::StressReport multiQueue = Panel::stressPanel<Panel::FrontPanel>(
+            m1, m1Replica, sources, eventsPerSource, multiEvent, multiSame);
+        MultiVM::VendingMachine m2, m2Replica;
+        stockMulti(m2);
+        stockMulti(m2Replica);
+        Panel::StressReport multiLocked = Panel::stressPanel<Panel::LockedPanel>(
+            m2, m2Replica, sources, eventsPerSource, multiEvent, multiSame);
+        cout.clear();
+
+        print("SimpleVM, event queue : ", simpleQueue);
+        print("SimpleVM, mutex       : ", simpleLocked);
+        print("MultiVM,  event queue : ", multiQueue);
+        print("MultiVM,  mutex       : ", multiLocked);
+    }
+
+    /* =========================================================
+       STATE MACHINE LIBRARY : TRANSITION TABLE THROUGHPUT
+       One random event stream per machine, dispatched
+       through its Fsm::Table; SimpleVM's stream also runs
+       through the virtual-call reference it replaced.
+       ========================================================= */
+    cout << "\n================ TRANSITION TABLE THROUGHPUT ================\n";
+
+    {
+        const int events = 5000000;
+        mt19937 rng(50);
+        vector<Panel::PanelEvent> stream(events);
+        for (Panel::PanelEvent& e : stream) {
+            int pick = rng() % 20;
+            e.slot = rng() % 8;
+            if (pick < 7)       { e.type = Panel::INSERT_COIN; e.value = 5 * (1 + rng() % 8); }
+            else if (pick < 12) e.type = Panel::SELECT_ITEM;
+            else if (pick < 17) e.type = Panel::DISPENSE;
+            else if (pick < 19) e.type = Panel::RETURN_COIN;
+            else                { e.type = Panel::REFILL; e.value = 1 + rng() % 5; }
+        }
+
+        auto perSecond = [&](chrono::steady_clock::duration d) {
+            return (long long)(events / chrono::duration<double>(d).count());
+        };
+
+        cout.setstate(ios::failbit);   // states print on bad input
+        SimpleVM::VendingMachine simple(1000, 20);
+        auto t0 = chrono::steady_clock::now();
+        for (const Panel::PanelEvent& e : stream) Panel::applyEvent(simple, e);
+        auto t1 = chrono::steady_clock::now();
+
+        MultiVM::VendingMachine multi;
+        for (int slot = 0; slot < 8; slot++)
+            multi.addItem("Item" + to_string(slot), 10 + 5 * slot, 1000);
+        auto t2 = chrono::steady_clock::now();
+        for (const Panel::PanelEvent& e : stream) Panel::applyEvent(multi, e);
+        auto t3 = chrono::steady_clock::now();
+
+        SimpleVM::ReferenceMachine reference(1000, 20);
+        auto t4 = chrono::steady_clock::now();
+        for (const Panel::PanelEvent& e : stream) Panel::applyEvent(reference, e);
+        auto t5 = chrono::steady_clock::now();
+        cout.clear();
+
+        bool sameRun = string(reference.getStateName()) == simple.getStateName()
+                    && reference.getItemCount() == simple.getItemCount()
+                    && reference.getCoins() == simple.getCoins();
+        cout << "SimpleVM, virtual calls | " << perSecond(t5 - t4) << " events/s | ends in "
+             << reference.getStateName() << endl;
+        cout << "SimpleVM | " << perSecond(t1 - t0) << " events/s | ends in "
+             << simple.getStateName() << " | same run as virtual calls: "
+             << (sameRun ? "YES" : "NO") << endl;
+        cout << "MultiVM  | " << perSecond(t3 - t2) << " events/s | ends in "
+             << multi.getStateName() << endl;
+    }
+
     return 0;
 }
\ No newline at end of file